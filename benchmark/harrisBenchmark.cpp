@@ -0,0 +1,135 @@
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "harrisFused.hpp"
+#include "keypointNMS.hpp"
+
+using namespace std;
+
+/*
+- Compares the cv::cornerHarris + cv::normalize Harris detector (HARRIS) with the fused kernel (HARRIS_FUSED)
+- Runs on the KITTI frames given on the command line, or on a synthetic KITTI sized frame
+*/
+
+// original detector: full frame response matrices, thresholding with .at<float> in a double loop
+void detectHarrisReference(vector<cv::KeyPoint> &keypoints, const cv::Mat &img)
+{
+    int blockSize = 2, apertureSize = 3, minResponse = 100;
+    double k = 0.04;
+
+    cv::Mat dst, dst_norm;
+    cv::cornerHarris(img, dst, blockSize, apertureSize, k, cv::BORDER_DEFAULT);
+    cv::normalize(dst, dst_norm, 0, 255, cv::NORM_MINMAX, CV_32FC1, cv::Mat());
+
+    KeypointGridNMS nms(keypoints, img.size(), 2 * apertureSize, 0.0);
+    for (int j = 0; j < dst_norm.rows; j++)
+    {
+        for (int i = 0; i < dst_norm.cols; i++)
+        {
+            int response = (int)dst_norm.at<float>(j, i);
+            if (response > minResponse)
+            {
+                cv::KeyPoint newKeyPoint;
+                newKeyPoint.pt = cv::Point2f(i, j);
+                newKeyPoint.size = 2 * apertureSize;
+                newKeyPoint.response = response;
+                nms.insert(newKeyPoint);
+            }
+        }
+    }
+}
+
+cv::Mat createFrame(cv::Size imgSize, cv::RNG &rng)
+{
+    cv::Mat img(imgSize, CV_8U);
+    rng.fill(img, cv::RNG::UNIFORM, 0, 256);
+    cv::GaussianBlur(img, img, cv::Size(0, 0), 3.0);
+    for (int i = 0; i < 200; i++) // bright and dark boxes give corners
+    {
+        cv::Point p(rng.uniform(0, imgSize.width), rng.uniform(0, imgSize.height));
+        cv::rectangle(img, cv::Rect(p, cv::Size(rng.uniform(5, 40), rng.uniform(5, 40))), cv::Scalar(rng.uniform(0, 256)), cv::FILLED);
+    }
+    return img;
+}
+
+double elapsedMs(double tStart)
+{
+    return (((double)cv::getTickCount() - tStart) * 1000) / cv::getTickFrequency(); // [ms]
+}
+
+int main(int argc, const char *argv[])
+{
+    vector<cv::Mat> frames;
+    vector<string> names;
+    for (int i = 1; i < argc; i++)
+    {
+        cv::Mat img = cv::imread(argv[i], cv::IMREAD_GRAYSCALE);
+        if (img.empty())
+        {
+            cerr << "could not read image " << argv[i] << endl;
+            return 1;
+        }
+        frames.push_back(img);
+        names.push_back(argv[i]);
+    }
+    if (frames.empty())
+    {
+        cv::RNG rng(42);
+        frames.push_back(createFrame(cv::Size(1242, 375), rng)); // KITTI frame
+        names.push_back("synthetic");
+    }
+
+    int repetitions = 10;
+    cv::setNumThreads(1); // both single threaded
+    FusedHarris fusedHarris;
+
+    cout << "Fused Harris implementation: " << FusedHarris::implementation() << endl;
+    cout << left << setw(24) << "frame" << right << setw(12) << "keypoints" << setw(18) << "reference [ms]"
+         << setw(12) << "fused [ms]" << setw(10) << "speedup" << setw(12) << "identical" << endl;
+
+    bool bAllIdentical = true;
+    for (size_t f = 0; f < frames.size(); f++)
+    {
+        double tRef = 1e30, tFused = 1e30;
+        vector<cv::KeyPoint> refKeypoints, fusedKeypoints;
+        for (int rep = 0; rep < repetitions; rep++)
+        {
+            refKeypoints.clear();
+            double t = (double)cv::getTickCount();
+            detectHarrisReference(refKeypoints, frames[f]);
+            tRef = min(tRef, elapsedMs(t));
+
+            fusedKeypoints.clear();
+            t = (double)cv::getTickCount();
+            fusedHarris.detect(fusedKeypoints, frames[f], 0.04, 100, 6.0f, 0.0);
+            tFused = min(tFused, elapsedMs(t));
+        }
+
+        // float rounding may move a response across the threshold, count keypoints found by both
+        size_t common = 0;
+        for (auto it = fusedKeypoints.begin(); it != fusedKeypoints.end(); ++it)
+            for (auto ref = refKeypoints.begin(); ref != refKeypoints.end(); ++ref)
+                if ((*ref).pt.x == (*it).pt.x && (*ref).pt.y == (*it).pt.y)
+                {
+                    common++;
+                    break;
+                }
+
+        bool bIdentical = common == refKeypoints.size() && common == fusedKeypoints.size();
+        bAllIdentical = bAllIdentical && bIdentical;
+
+        string name = names[f].size() > 22 ? "..." + names[f].substr(names[f].size() - 19) : names[f];
+        cout << left << setw(24) << name << right << setw(12) << fusedKeypoints.size()
+             << setw(18) << tRef << setw(12) << tFused << setw(10) << tRef / max(tFused, 1e-6)
+             << setw(12) << (bIdentical ? "yes" : to_string(common) + "/" + to_string(refKeypoints.size())) << endl;
+    }
+
+    return bAllIdentical ? 0 : 1; // non-zero if the fused detector differs from cv::cornerHarris on any frame
+}
@@ -0,0 +1,110 @@
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "featureStore.hpp"
+#include "guidedMatching.hpp"
+#include "simdMatching.hpp"
+
+using namespace std;
+
+/*
+- Replays descriptor matching on a feature store written with 2D_feature_tracking --features <prefix>
+- Detection and description are not repeated, the descriptors are used straight from the mapped file
+- Every consecutive pair of records is matched with cv::BFMatcher, the native SIMD matcher (binary or quantized
+  descriptors) and the motion-guided matcher, all with the ratio test
+*/
+
+double elapsedMs(double tStart)
+{
+    return (((double)cv::getTickCount() - tStart) * 1000) / cv::getTickFrequency(); // [ms]
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 2)
+    {
+        cout << "usage: match_replay <file.feat>" << endl;
+        return 1;
+    }
+
+    FeatureStoreReader store;
+    store.open(argv[1]);
+    cout << argv[1] << ": " << store.size() << " frames" << endl;
+    if (store.size() < 2)
+        return 0;
+
+    double minDescDistRatio = 0.8;
+    float guidedSearchRadius = 24.0f, guidedInitialRadius = 80.0f; // see PipelineConfig
+    // the store records the norm, 8-bit rows matched with L2 are quantized SIFT (--quantize)
+    bool bBinary = store.normType() == cv::NORM_HAMMING;
+    bool bQuantized = false;
+    for (size_t i = 0; i < store.size(); i++)
+    {
+        if (!store.frame(i).descriptors.empty()) // frames without keypoints store an empty 0x0 matrix
+        {
+            bQuantized = !bBinary && store.frame(i).descriptors.depth() == CV_8U;
+            break;
+        }
+    }
+    cv::Ptr<cv::BFMatcher> bfMatcher = cv::BFMatcher::create(store.normType(), false);
+    GuidedMatcher guidedMatcher;
+
+    cout << setw(6) << "frame" << setw(10) << "stored" << setw(10) << "BF" << setw(10) << "BF [ms]"
+         << setw(10) << "SIMD" << setw(11) << "SIMD [ms]" << setw(10) << "guided" << setw(13) << "guided [ms]" << endl;
+
+    vector<cv::KeyPoint> kptsSource, kptsRef;
+    vector<cv::Point2f> motion;
+    store.frame(0).copyKeypoints(kptsSource);
+    for (size_t i = 1; i < store.size(); i++)
+    {
+        const FeatureFrameView &source = store.frame(i - 1), &ref = store.frame(i);
+        ref.copyKeypoints(kptsRef);
+
+        double t = (double)cv::getTickCount();
+        vector<vector<cv::DMatch>> knnMatches;
+        vector<cv::DMatch> bfMatches;
+        if (!source.descriptors.empty() && !ref.descriptors.empty())
+            bfMatcher->knnMatch(source.descriptors, ref.descriptors, knnMatches, 2);
+        for (auto it = knnMatches.begin(); it != knnMatches.end(); ++it)
+            if ((*it).size() > 1 && (*it)[0].distance < minDescDistRatio * (*it)[1].distance)
+                bfMatches.push_back((*it)[0]);
+        double tBF = elapsedMs(t);
+
+        vector<cv::DMatch> simdMatches;
+        double tSIMD = 0.0;
+        if (bBinary || bQuantized)
+        {
+            t = (double)cv::getTickCount();
+            if (bBinary)
+                matchHammingKnnRatio(source.descriptors, ref.descriptors, simdMatches, minDescDistRatio);
+            else
+                matchL2KnnRatio(source.descriptors, ref.descriptors, simdMatches, minDescDistRatio);
+            tSIMD = elapsedMs(t);
+        }
+
+        // constant velocity prediction from the previous replayed pair
+        t = (double)cv::getTickCount();
+        vector<cv::DMatch> guidedMatches;
+        float radius = motion.size() == kptsSource.size() && !motion.empty() ? guidedSearchRadius : guidedInitialRadius;
+        guidedMatcher.match(kptsSource, source.descriptors, motion, kptsRef, ref.descriptors, radius, minDescDistRatio, guidedMatches,
+                            store.normType());
+        estimateKeypointMotion(kptsSource, kptsRef, guidedMatches, motion);
+        double tGuided = elapsedMs(t);
+
+        cout << setw(6) << ref.frameIndex << setw(10) << ref.matchCount() << setw(10) << bfMatches.size() << setw(10) << tBF;
+        if (bBinary || bQuantized)
+            cout << setw(10) << simdMatches.size() << setw(11) << tSIMD;
+        else
+            cout << setw(10) << "-" << setw(11) << "-";
+        cout << setw(10) << guidedMatches.size() << setw(13) << tGuided << endl;
+
+        kptsSource.swap(kptsRef);
+    }
+
+    return 0;
+}
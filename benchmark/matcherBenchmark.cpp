@@ -0,0 +1,172 @@
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "simdMatching.hpp"
+
+using namespace std;
+
+/*
+- Compares cv::BFMatcher (knnMatch + ratio test) with the native SIMD Hamming matcher
+- Reference descriptors are noisy copies of the source descriptors, so the ratio test keeps realistic match counts
+- SIFT-like descriptors (128 integer valued floats): FLANN and cv::BFMatcher on floats against the native integer L2
+  matcher on the quantized 8-bit rows
+*/
+
+cv::Mat createDescriptors(int rows, int bytes, cv::RNG &rng)
+{
+    cv::Mat desc(rows, bytes, CV_8U);
+    rng.fill(desc, cv::RNG::UNIFORM, 0, 256);
+    return desc;
+}
+
+cv::Mat perturbDescriptors(const cv::Mat &desc, int flippedBits, cv::RNG &rng)
+{
+    cv::Mat noisy = desc.clone();
+    for (int r = 0; r < noisy.rows; r++)
+    {
+        for (int k = 0; k < flippedBits; k++)
+        {
+            int bit = rng.uniform(0, noisy.cols * 8);
+            noisy.at<uchar>(r, bit / 8) ^= (uchar)(1 << (bit % 8));
+        }
+    }
+    return noisy;
+}
+
+// integer valued floats in [0, 255] like OpenCV's SIFT output, the reference rows get additive noise
+cv::Mat createSiftDescriptors(int rows, cv::RNG &rng)
+{
+    cv::Mat desc(rows, 128, CV_32F);
+    for (int r = 0; r < rows; r++)
+        for (int c = 0; c < 128; c++)
+            desc.at<float>(r, c) = (float)min(255, (int)(-30.0 * log(rng.uniform(1e-6, 1.0)))); // exponential: mostly small bins, a few strong ones
+    return desc;
+}
+
+cv::Mat perturbSiftDescriptors(const cv::Mat &desc, double sigma, cv::RNG &rng)
+{
+    cv::Mat noisy = desc.clone();
+    for (int r = 0; r < noisy.rows; r++)
+        for (int c = 0; c < noisy.cols; c++)
+            noisy.at<float>(r, c) = (float)max(0, min(255, cvRound(noisy.at<float>(r, c) + rng.gaussian(sigma))));
+    return noisy;
+}
+
+double elapsedMs(double tStart)
+{
+    return (((double)cv::getTickCount() - tStart) * 1000) / cv::getTickFrequency(); // [ms]
+}
+
+int main(int argc, const char *argv[])
+{
+    vector<int> descriptorBytes = {32, 61, 64}; // ORB/BRIEF, AKAZE, BRISK/FREAK
+    vector<int> keypointCounts = {500, 1000, 2000, 5000};
+    double minDescDistRatio = 0.8;
+    int repetitions = 3;
+
+    cv::RNG rng(42);
+    cv::Ptr<cv::BFMatcher> bfMatcher = cv::BFMatcher::create(cv::NORM_HAMMING, false);
+    bool bAllIdentical = true;
+
+    cout << "Hamming implementation: " << hammingImplementation() << endl;
+    cout << setw(8) << "bytes" << setw(10) << "N" << setw(10) << "matches"
+         << setw(16) << "BFMatcher [ms]" << setw(12) << "SIMD [ms]" << setw(10) << "speedup" << setw(12) << "identical" << endl;
+
+    for (auto bytes = descriptorBytes.begin(); bytes != descriptorBytes.end(); ++bytes)
+    {
+        for (auto n = keypointCounts.begin(); n != keypointCounts.end(); ++n)
+        {
+            cv::Mat descSource = createDescriptors(*n, *bytes, rng);
+            cv::Mat descRef = perturbDescriptors(descSource, *bytes, rng); // ~12% of the bits flipped
+
+            double tBF = 1e30, tSIMD = 1e30;
+            vector<cv::DMatch> bfMatches, simdMatches;
+            for (int rep = 0; rep < repetitions; rep++)
+            {
+                // OpenCV: knn lists first, ratio test afterwards
+                double t = (double)cv::getTickCount();
+                vector<vector<cv::DMatch>> knnMatches;
+                bfMatches.clear();
+                bfMatcher->knnMatch(descSource, descRef, knnMatches, 2);
+                for (auto it = knnMatches.begin(); it != knnMatches.end(); ++it)
+                    if ((*it)[0].distance < minDescDistRatio * (*it)[1].distance)
+                        bfMatches.push_back((*it)[0]);
+                tBF = min(tBF, elapsedMs(t));
+
+                // native: ratio test fused into the search
+                t = (double)cv::getTickCount();
+                simdMatches.clear();
+                matchHammingKnnRatio(descSource, descRef, simdMatches, minDescDistRatio);
+                tSIMD = min(tSIMD, elapsedMs(t));
+            }
+
+            bool bIdentical = bfMatches.size() == simdMatches.size();
+            for (size_t i = 0; bIdentical && i < bfMatches.size(); i++)
+                bIdentical = bfMatches[i].queryIdx == simdMatches[i].queryIdx && bfMatches[i].trainIdx == simdMatches[i].trainIdx;
+            bAllIdentical = bAllIdentical && bIdentical;
+
+            cout << setw(8) << *bytes << setw(10) << *n << setw(10) << simdMatches.size()
+                 << setw(16) << tBF << setw(12) << tSIMD << setw(10) << tBF / max(tSIMD, 1e-6)
+                 << setw(12) << (bIdentical ? "yes" : "NO") << endl;
+        }
+    }
+
+    // #### quantized gradient descriptors ####
+    cout << endl << "L2 implementation: " << l2Implementation() << endl;
+    cout << setw(10) << "N" << setw(10) << "matches" << setw(12) << "FLANN [ms]" << setw(16) << "BFMatcher [ms]"
+         << setw(12) << "SIMD [ms]" << setw(10) << "speedup" << setw(12) << "identical" << setw(16) << "bytes float/8U" << endl;
+
+    cv::Ptr<cv::BFMatcher> bfL2Matcher = cv::BFMatcher::create(cv::NORM_L2, false);
+    cv::Ptr<cv::DescriptorMatcher> flannMatcher = cv::DescriptorMatcher::create(cv::DescriptorMatcher::FLANNBASED);
+    for (auto n = keypointCounts.begin(); n != keypointCounts.end(); ++n)
+    {
+        cv::Mat descSource = createSiftDescriptors(*n, rng);
+        cv::Mat descRef = perturbSiftDescriptors(descSource, 12.0, rng);
+        cv::Mat quantSource, quantRef;
+        quantizeDescriptors(descSource, quantSource);
+        quantizeDescriptors(descRef, quantRef);
+
+        double tFlann = 1e30, tBF = 1e30, tSIMD = 1e30;
+        vector<cv::DMatch> bfMatches, simdMatches;
+        for (int rep = 0; rep < repetitions; rep++)
+        {
+            // approximate k-d tree, index built on every call like in the pipeline
+            double t = (double)cv::getTickCount();
+            vector<vector<cv::DMatch>> knnMatches;
+            flannMatcher->knnMatch(descSource, descRef, knnMatches, 2);
+            tFlann = min(tFlann, elapsedMs(t));
+
+            t = (double)cv::getTickCount();
+            knnMatches.clear();
+            bfMatches.clear();
+            bfL2Matcher->knnMatch(descSource, descRef, knnMatches, 2);
+            for (auto it = knnMatches.begin(); it != knnMatches.end(); ++it)
+                if ((*it)[0].distance < minDescDistRatio * (*it)[1].distance)
+                    bfMatches.push_back((*it)[0]);
+            tBF = min(tBF, elapsedMs(t));
+
+            t = (double)cv::getTickCount();
+            simdMatches.clear();
+            matchL2KnnRatio(quantSource, quantRef, simdMatches, minDescDistRatio);
+            tSIMD = min(tSIMD, elapsedMs(t));
+        }
+
+        // the ratio test on squared integer distances can only differ from float rounding at exact ties
+        bool bIdentical = bfMatches.size() == simdMatches.size();
+        for (size_t i = 0; bIdentical && i < bfMatches.size(); i++)
+            bIdentical = bfMatches[i].queryIdx == simdMatches[i].queryIdx && bfMatches[i].trainIdx == simdMatches[i].trainIdx;
+        bAllIdentical = bAllIdentical && bIdentical;
+
+        cout << setw(10) << *n << setw(10) << simdMatches.size() << setw(12) << tFlann << setw(16) << tBF
+             << setw(12) << tSIMD << setw(10) << tFlann / max(tSIMD, 1e-6) << setw(12) << (bIdentical ? "yes" : "NO")
+             << setw(9) << descSource.total() * descSource.elemSize() / *n << "/" << quantSource.total() * quantSource.elemSize() / *n << endl;
+    }
+
+    return bAllIdentical ? 0 : 1; // non-zero if a native matcher differs from cv::BFMatcher
+}
@@ -0,0 +1,415 @@
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <functional>
+#include <tuple>
+#include <algorithm>
+#include <cstdlib>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "matching2D.hpp"
+#include "simdMatching.hpp"
+#include "benchmarkHarness.hpp"
+
+using namespace std;
+
+/*
+- Micro-benchmarks of the free pipeline functions on procedurally generated frames, no dataset needed
+- Every detector, every descriptor and every matcher / selector pair, one row each
+- Frames are textured noise with filled boxes (corners) and discs (blobs), their number is set by the density in
+  shapes per 100x100 px. The second frame is the same scene shifted by a few pixels plus sensor noise, so matching
+  finds real correspondences. A fixed seed makes every run see the same pixels.
+- Throughput: keypoints/s (found, described or matched) and bytes/s (image bytes for detectors, descriptor bytes
+  written for descriptors, descriptor bytes a brute-force search compares for matchers, also for FLANN)
+- --scaling adds two sweeps: detector time against density (NMS cost with the number of candidates) and matcher
+  time against the number of keypoints N
+- One untimed call per benchmark creates the cached pipeline, the table shows median and p95 of the repetitions
+
+usage: micro_benchmark [--size <w>x<h>] [--density <shapes>] [--kpts <n>] [--reps <n>] [--seed <n>]
+                       [--filter <text>] [--csv <file>] [--scaling]
+*/
+
+struct MicroSettings {
+
+    cv::Size imgSize = cv::Size(1242, 375); // KITTI frame
+    double density = 4.0; // filled shapes per 100x100 px
+    int keypointBudget = 1000; // keypoints described and matched
+    int repetitions = 10;
+    uint64 seed = 42;
+    string filter; // only benchmarks whose name contains it
+    bool bScaling = false;
+};
+
+struct MicroResult {
+
+    string name;
+    double param; // density for detectors, keypoints in for descriptors and matchers
+    SampleSummary time; // [ms]
+    size_t outputs; // keypoints found, descriptors computed or matches kept
+    double keypoints; // keypoints processed per call
+    double bytes; // bytes processed per call
+};
+
+// scene of size + shift, both frames are crops of it
+cv::Mat createScene(cv::Size sceneSize, double density, cv::RNG &rng)
+{
+    cv::Mat img(sceneSize, CV_8U);
+    rng.fill(img, cv::RNG::UNIFORM, 0, 256);
+    cv::GaussianBlur(img, img, cv::Size(0, 0), 3.0); // low contrast texture
+
+    int shapes = (int)(density * sceneSize.area() / 10000.0);
+    for (int i = 0; i < shapes; i++)
+    {
+        cv::Point p(rng.uniform(0, sceneSize.width), rng.uniform(0, sceneSize.height));
+        cv::Scalar color(rng.uniform(0, 256));
+        if (rng.uniform(0, 4) > 0) // bright and dark boxes give corners
+            cv::rectangle(img, cv::Rect(p, cv::Size(rng.uniform(5, 40), rng.uniform(5, 40))), color, cv::FILLED);
+        else // discs give blobs for the scale space detectors
+            cv::circle(img, p, rng.uniform(3, 20), color, cv::FILLED);
+    }
+    return img;
+}
+
+cv::Mat addNoise(const cv::Mat &img, double sigma, cv::RNG &rng)
+{
+    cv::Mat noise(img.size(), CV_16S), noisy;
+    rng.fill(noise, cv::RNG::NORMAL, 0, sigma);
+    cv::add(img, noise, noisy, cv::noArray(), CV_8U);
+    return noisy;
+}
+
+// two frames of the same scene, the second one moved by (4, 2) px with independent noise
+void createFramePair(cv::Size imgSize, double density, uint64 seed, cv::Mat &imgFirst, cv::Mat &imgSecond)
+{
+    cv::RNG rng(seed);
+    cv::Point shift(4, 2);
+    cv::Mat scene = createScene(imgSize + cv::Size(shift.x, shift.y), density, rng);
+    imgFirst = addNoise(scene(cv::Rect(cv::Point(0, 0), imgSize)), 2.0, rng);
+    imgSecond = addNoise(scene(cv::Rect(shift, imgSize)), 2.0, rng);
+}
+
+double elapsedMs(double tStart)
+{
+    return (((double)cv::getTickCount() - tStart) * 1000) / cv::getTickFrequency(); // [ms]
+}
+
+// one untimed call first: it creates the cached pipeline and runs OpenCV's lazy initialization
+SampleSummary measure(int repetitions, const function<void()> &call)
+{
+    call();
+    vector<double> samples;
+    for (int rep = 0; rep < repetitions; rep++)
+    {
+        double t = (double)cv::getTickCount();
+        call();
+        samples.push_back(elapsedMs(t));
+    }
+    return summarize(samples);
+}
+
+void printHeader(ostream *csv)
+{
+    cout << left << setw(34) << "benchmark" << right << setw(8) << "N" << setw(13) << "median [ms]" << setw(11) << "p95 [ms]"
+         << setw(9) << "out" << setw(13) << "kpts/s" << setw(11) << "MB/s" << endl;
+    if (csv)
+        *csv << "benchmark,n,median_ms,p95_ms,outputs,keypoints_per_s,bytes_per_s" << endl;
+}
+
+void printResult(const MicroResult &result, ostream *csv)
+{
+    double seconds = max(result.time.median, 1e-6) / 1000.0;
+    cout << left << setw(34) << result.name << right << setw(8) << result.param
+         << fixed << setprecision(3) << setw(13) << result.time.median << setw(11) << result.time.p95
+         << setw(9) << result.outputs << setprecision(0) << setw(13) << result.keypoints / seconds
+         << setprecision(1) << setw(11) << result.bytes / seconds / 1e6 << endl;
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+    if (csv)
+        *csv << result.name << "," << result.param << "," << result.time.median << "," << result.time.p95 << ","
+             << result.outputs << "," << result.keypoints / seconds << "," << result.bytes / seconds << endl;
+}
+
+bool selected(const MicroSettings &settings, const string &name)
+{
+    return settings.filter.empty() || name.find(settings.filter) != string::npos;
+}
+
+// HARRIS and SHITOMASI have their own free functions, all others go through detKeypointsModern
+double detect(const string &detectorType, vector<cv::KeyPoint> &keypoints, const cv::Mat &img)
+{
+    if (detectorType.compare("SHITOMASI") == 0)
+        return detKeypointsShiTomasi(keypoints, img, false);
+    if (detectorType.compare("HARRIS") == 0)
+        return detKeypointsHarris(keypoints, img, false);
+    return detKeypointsModern(keypoints, img, detectorType, false);
+}
+
+MicroResult benchmarkDetector(const MicroSettings &settings, const string &detectorType, const cv::Mat &img, double density)
+{
+    vector<cv::KeyPoint> keypoints;
+    MicroResult result;
+    result.name = "detect/" + detectorType;
+    result.param = density;
+    result.time = measure(settings.repetitions, [&]() {
+        keypoints.clear();
+        detect(detectorType, keypoints, img);
+    });
+    result.outputs = keypoints.size();
+    result.keypoints = keypoints.size();
+    result.bytes = img.total() * img.elemSize();
+    return result;
+}
+
+// strongest keypoints of the frame, limited to budget
+vector<cv::KeyPoint> detectBudget(const string &detectorType, const cv::Mat &img, int budget)
+{
+    vector<cv::KeyPoint> keypoints;
+    detect(detectorType, keypoints, img);
+    cv::KeyPointsFilter::retainBest(keypoints, budget);
+    if ((int)keypoints.size() > budget) // retainBest keeps all ties of the last response
+        keypoints.resize(budget);
+    return keypoints;
+}
+
+MicroResult benchmarkDescriptor(const MicroSettings &settings, const string &descriptorType, const vector<cv::KeyPoint> &keypoints,
+                                const cv::Mat &img)
+{
+    vector<cv::KeyPoint> described;
+    cv::Mat descriptors;
+    MicroResult result;
+    result.name = "describe/" + descriptorType;
+    result.param = keypoints.size();
+    result.time = measure(settings.repetitions, [&]() {
+        described = keypoints; // extractors remove keypoints too close to the border
+        descKeypoints(described, img, descriptors, descriptorType);
+    });
+    result.outputs = descriptors.rows;
+    result.keypoints = described.size();
+    result.bytes = descriptors.total() * descriptors.elemSize();
+    return result;
+}
+
+// descriptors of both frames, computed once and shared by all matcher benchmarks of this descriptor
+struct MatchInput {
+
+    string descriptorType, descriptorFamily;
+    vector<cv::KeyPoint> kptsSource, kptsRef;
+    cv::Mat descSource, descRef;
+    int detected; // source keypoints before the extractor removed the ones at the border
+};
+
+MatchInput describeFramePair(const string &detectorType, const string &descriptorType, const cv::Mat &imgFirst,
+                             const cv::Mat &imgSecond, int budget)
+{
+    MatchInput input;
+    input.descriptorType = descriptorType;
+    input.descriptorFamily = descriptorType.compare("SIFT") == 0 ? "DES_HOG" : "DES_BINARY";
+    input.kptsSource = detectBudget(detectorType, imgSecond, budget); // current frame
+    input.kptsRef = detectBudget(detectorType, imgFirst, budget); // previous frame
+    input.detected = input.kptsSource.size();
+    descKeypoints(input.kptsSource, imgSecond, input.descSource, descriptorType);
+    descKeypoints(input.kptsRef, imgFirst, input.descRef, descriptorType);
+    return input;
+}
+
+MicroResult benchmarkMatcher(const MicroSettings &settings, MatchInput &input, const string &matcherType, const string &selectorType)
+{
+    vector<cv::DMatch> matches;
+    MicroResult result;
+    result.name = "match/" + input.descriptorType + " " + matcherType + " " + selectorType;
+    result.param = input.descSource.rows;
+    result.time = measure(settings.repetitions, [&]() {
+        matches.clear();
+        matchDescriptors(input.kptsSource, input.kptsRef, input.descSource, input.descRef, matches,
+                         input.descriptorFamily, matcherType, selectorType);
+    });
+    result.outputs = matches.size();
+    result.keypoints = input.descSource.rows;
+    result.bytes = (double)input.descSource.rows * input.descRef.rows * input.descRef.cols * input.descRef.elemSize();
+    return result;
+}
+
+// MAT_SIMD compares SIFT descriptors as quantized 8-bit rows, see --quantize
+void quantize(MatchInput &input)
+{
+    cv::Mat quantized;
+    quantizeDescriptors(input.descSource, quantized);
+    input.descSource = quantized;
+    quantizeDescriptors(input.descRef, quantized);
+    input.descRef = quantized;
+    input.descriptorType += "(8U)";
+}
+
+// MAT_GUIDED needs the keypoint motion of a DataFrame sequence, the free function falls back to MAT_BF
+// returns the number of detected source keypoints, 0 if no benchmark of this descriptor is selected
+int runMatchers(const MicroSettings &settings, const string &descriptorType, const cv::Mat &imgFirst, const cv::Mat &imgSecond,
+                int budget, ostream *csv)
+{
+    bool bBinary = descriptorType.compare("SIFT") != 0;
+    vector<string> matcherTypes = {"MAT_BF", "MAT_FLANN", "MAT_SIMD"}, selectorTypes = {"SEL_NN", "SEL_KNN"};
+
+    // (quantized, matcher, selector) of the selected benchmarks
+    vector<tuple<bool, string, string>> benchmarks;
+    for (auto matcherType = matcherTypes.begin(); matcherType != matcherTypes.end(); ++matcherType)
+    {
+        for (auto selectorType = selectorTypes.begin(); selectorType != selectorTypes.end(); ++selectorType)
+        {
+            bool bQuantized = !bBinary && (*matcherType).compare("MAT_SIMD") == 0; // no float SIMD matcher
+            string name = "match/" + descriptorType + (bQuantized ? "(8U) " : " ") + *matcherType + " " + *selectorType;
+            if (selected(settings, name))
+                benchmarks.push_back(make_tuple(bQuantized, *matcherType, *selectorType));
+        }
+    }
+    if (benchmarks.empty())
+        return 0;
+
+    MatchInput input = describeFramePair("FAST", descriptorType, imgFirst, imgSecond, budget);
+    MatchInput quantized = input;
+    if (!bBinary)
+        quantize(quantized);
+    for (auto it = benchmarks.begin(); it != benchmarks.end(); ++it)
+        printResult(benchmarkMatcher(settings, get<0>(*it) ? quantized : input, get<1>(*it), get<2>(*it)), csv);
+    return input.detected;
+}
+
+bool parseSize(const string &arg, cv::Size &size)
+{
+    size_t x = arg.find('x');
+    if (x == string::npos)
+        return false;
+    size.width = atoi(arg.substr(0, x).c_str());
+    size.height = atoi(arg.substr(x + 1).c_str());
+    return size.width > 0 && size.height > 0;
+}
+
+int main(int argc, const char *argv[])
+{
+    MicroSettings settings;
+    string csvFile;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        bool bHasValue = i + 1 < argc;
+        if (arg.compare("--size") == 0 && bHasValue)
+        {
+            if (!parseSize(argv[++i], settings.imgSize))
+            {
+                cerr << "--size expects <width>x<height>" << endl;
+                return 1;
+            }
+        }
+        else if (arg.compare("--density") == 0 && bHasValue)
+            settings.density = max(0.0, atof(argv[++i]));
+        else if (arg.compare("--kpts") == 0 && bHasValue)
+            settings.keypointBudget = max(1, atoi(argv[++i]));
+        else if (arg.compare("--reps") == 0 && bHasValue)
+            settings.repetitions = max(1, atoi(argv[++i]));
+        else if (arg.compare("--seed") == 0 && bHasValue)
+            settings.seed = (uint64)strtoull(argv[++i], nullptr, 10);
+        else if (arg.compare("--filter") == 0 && bHasValue)
+            settings.filter = argv[++i];
+        else if (arg.compare("--csv") == 0 && bHasValue)
+            csvFile = argv[++i];
+        else if (arg.compare("--scaling") == 0)
+            settings.bScaling = true;
+        else
+        {
+            cerr << "usage: micro_benchmark [--size <w>x<h>] [--density <shapes>] [--kpts <n>] [--reps <n>] [--seed <n>]"
+                 << " [--filter <text>] [--csv <file>] [--scaling]" << endl;
+            return 1;
+        }
+    }
+
+    ofstream csvStream;
+    ostream *csv = nullptr;
+    if (!csvFile.empty())
+    {
+        csvStream.open(csvFile);
+        if (!csvStream)
+        {
+            cerr << "could not open " << csvFile << endl;
+            return 1;
+        }
+        csv = &csvStream;
+    }
+
+    cv::setNumThreads(1); // single core numbers, comparable between runs and machines
+    cv::Mat imgFirst, imgSecond;
+    createFramePair(settings.imgSize, settings.density, settings.seed, imgFirst, imgSecond);
+
+    cout << "frame " << settings.imgSize.width << "x" << settings.imgSize.height << ", density " << settings.density
+         << " shapes per 100x100 px, " << settings.keypointBudget << " keypoints, " << settings.repetitions << " repetitions, seed "
+         << settings.seed << endl;
+    cout << "Hamming implementation: " << hammingImplementation() << ", L2 implementation: " << l2Implementation() << endl << endl;
+    printHeader(csv);
+
+    // #### detectors ####
+    vector<string> detectorTypes = {"SHITOMASI", "HARRIS", "HARRIS_FUSED", "FAST", "BRISK", "ORB", "AKAZE", "SIFT"};
+    for (auto detectorType = detectorTypes.begin(); detectorType != detectorTypes.end(); ++detectorType)
+        if (selected(settings, "detect/" + *detectorType))
+            printResult(benchmarkDetector(settings, *detectorType, imgFirst, settings.density), csv);
+
+    // #### descriptors ####
+    // FAST corners for all of them, AKAZE descriptors need the class_id of AKAZE keypoints
+    vector<string> descriptorTypes = {"BRISK", "BRIEF", "ORB", "FREAK", "AKAZE", "SIFT"};
+    vector<cv::KeyPoint> fastKeypoints = detectBudget("FAST", imgFirst, settings.keypointBudget);
+    vector<cv::KeyPoint> akazeKeypoints;
+    for (auto descriptorType = descriptorTypes.begin(); descriptorType != descriptorTypes.end(); ++descriptorType)
+    {
+        if (!selected(settings, "describe/" + *descriptorType))
+            continue;
+        bool bAkaze = (*descriptorType).compare("AKAZE") == 0;
+        if (bAkaze && akazeKeypoints.empty())
+            akazeKeypoints = detectBudget("AKAZE", imgFirst, settings.keypointBudget);
+        printResult(benchmarkDescriptor(settings, *descriptorType, bAkaze ? akazeKeypoints : fastKeypoints, imgFirst), csv);
+    }
+
+    // #### matchers ####
+    // BRISK (64 bytes) and ORB (32 bytes) as binary descriptors, SIFT as float and quantized gradient histograms
+    vector<string> matchDescriptorTypes = {"BRISK", "ORB", "SIFT"};
+    for (auto descriptorType = matchDescriptorTypes.begin(); descriptorType != matchDescriptorTypes.end(); ++descriptorType)
+        runMatchers(settings, *descriptorType, imgFirst, imgSecond, settings.keypointBudget, csv);
+
+    if (!settings.bScaling)
+        return 0;
+
+    // #### scaling: detector time against density ####
+    // more shapes give more candidates, the time per keypoint shows where the NMS cost grows faster than linear
+    cout << endl << "scaling with density (shapes per 100x100 px)" << endl;
+    vector<double> densities = {1, 2, 4, 8, 16, 32};
+    vector<string> nmsDetectorTypes = {"SHITOMASI", "HARRIS", "HARRIS_FUSED", "FAST"};
+    for (auto detectorType = nmsDetectorTypes.begin(); detectorType != nmsDetectorTypes.end(); ++detectorType)
+    {
+        if (!selected(settings, "detect/" + *detectorType))
+            continue;
+        for (auto density = densities.begin(); density != densities.end(); ++density)
+        {
+            cv::Mat img, imgUnused;
+            createFramePair(settings.imgSize, *density, settings.seed, img, imgUnused);
+            printResult(benchmarkDetector(settings, *detectorType, img, *density), csv);
+        }
+    }
+
+    // #### scaling: matcher time against N ####
+    // a dense frame supplies the keypoints, N is capped by what FAST finds in it (raise --size for more)
+    cout << endl << "scaling with keypoints N" << endl;
+    vector<int> keypointCounts = {250, 500, 1000, 2000, 4000};
+    cv::Mat denseFirst, denseSecond;
+    createFramePair(settings.imgSize, 32.0, settings.seed, denseFirst, denseSecond);
+    for (auto descriptorType = matchDescriptorTypes.begin(); descriptorType != matchDescriptorTypes.end(); ++descriptorType)
+    {
+        for (auto n = keypointCounts.begin(); n != keypointCounts.end(); ++n)
+        {
+            int rows = runMatchers(settings, *descriptorType, denseFirst, denseSecond, *n, csv);
+            if (rows < *n)
+                break; // frame exhausted, a larger N would repeat this row
+        }
+    }
+
+    return 0;
+}
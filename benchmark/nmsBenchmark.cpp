@@ -0,0 +1,87 @@
+/* INCLUDES FOR THIS PROJECT */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+#include "keypointNMS.hpp"
+
+using namespace std;
+
+/*
+- Compares the original sequential Harris NMS loop with the grid-bucketed NMS
+- Candidates are random Harris-like corners on a KITTI sized frame, visited in raster order
+*/
+
+vector<cv::KeyPoint> createCandidates(int n, cv::Size imgSize, float kptSize, cv::RNG &rng)
+{
+    vector<cv::KeyPoint> candidates;
+    candidates.reserve(n);
+    for (int i = 0; i < n; i++)
+    {
+        cv::KeyPoint newKeyPoint;
+        newKeyPoint.pt = cv::Point2f(rng.uniform(0, imgSize.width), rng.uniform(0, imgSize.height));
+        newKeyPoint.size = kptSize;
+        newKeyPoint.response = rng.uniform(101, 256);
+        candidates.push_back(newKeyPoint);
+    }
+
+    // Harris visits the response image row by row
+    sort(candidates.begin(), candidates.end(), [](const cv::KeyPoint &a, const cv::KeyPoint &b) {
+        return a.pt.y < b.pt.y || (a.pt.y == b.pt.y && a.pt.x < b.pt.x);
+    });
+    return candidates;
+}
+
+bool identical(const vector<cv::KeyPoint> &a, const vector<cv::KeyPoint> &b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i].pt.x != b[i].pt.x || a[i].pt.y != b[i].pt.y || a[i].response != b[i].response)
+            return false;
+    return true;
+}
+
+int main(int argc, const char *argv[])
+{
+    cv::Size imgSize(1242, 375); // KITTI frame
+    float kptSize = 6.0f;        // 2 * apertureSize as in detKeypointsHarris
+    double maxOverlap = 0.0;
+    vector<int> candidateCounts = {1000, 10000, 100000};
+
+    cv::RNG rng(42);
+    bool bAllIdentical = true;
+
+    cout << setw(12) << "candidates" << setw(12) << "keypoints"
+         << setw(18) << "reference [ms]" << setw(14) << "grid [ms]" << setw(10) << "speedup" << setw(12) << "identical" << endl;
+
+    for (auto n = candidateCounts.begin(); n != candidateCounts.end(); ++n)
+    {
+        vector<cv::KeyPoint> candidates = createCandidates(*n, imgSize, kptSize, rng);
+
+        // original O(N^2) loop
+        vector<cv::KeyPoint> refKeypoints;
+        double tRef = (double)cv::getTickCount();
+        for (auto it = candidates.begin(); it != candidates.end(); ++it)
+            nmsKeypointsReference(refKeypoints, *it, maxOverlap);
+        tRef = (((double)cv::getTickCount() - tRef) * 1000) / cv::getTickFrequency(); // [ms]
+
+        // grid-bucketed NMS
+        vector<cv::KeyPoint> gridKeypoints;
+        double tGrid = (double)cv::getTickCount();
+        KeypointGridNMS nms(gridKeypoints, imgSize, kptSize, maxOverlap);
+        for (auto it = candidates.begin(); it != candidates.end(); ++it)
+            nms.insert(*it);
+        tGrid = (((double)cv::getTickCount() - tGrid) * 1000) / cv::getTickFrequency(); // [ms]
+
+        bool bIdentical = identical(refKeypoints, gridKeypoints);
+        bAllIdentical = bAllIdentical && bIdentical;
+        cout << setw(12) << *n << setw(12) << gridKeypoints.size()
+             << setw(18) << tRef << setw(14) << tGrid << setw(10) << tRef / max(tGrid, 1e-6)
+             << setw(12) << (bIdentical ? "yes" : "NO") << endl;
+    }
+
+    return bAllIdentical ? 0 : 1; // non-zero if the grid NMS differs from the reference
+}
@@ -1,11 +1,18 @@
 /* INCLUDES FOR THIS PROJECT */
 #include <iostream>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
 #include <vector>
+#include <map>
 #include <cmath>
 #include <limits>
+#include <memory>
+#include <thread>
+#include <cctype>
+#include <cstdlib>
+#include <cstdio>
 #include <opencv2/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -15,6 +22,22 @@
 
 #include "dataStructures.h"
 #include "matching2D.hpp"
+#include "featurePipeline.hpp"
+#include "threadPool.hpp"
+#include "frameSource.hpp"
+#include "frameStore.hpp"
+#include "detectionCache.hpp"
+#include "streamPipeline.hpp"
+#include "ringBuffer.hpp"
+#include "allocationCounter.hpp"
+#include "benchmarkHarness.hpp"
+#include "tracing.hpp"
+#include "tiledDetector.hpp"
+#include "kltTracker.hpp"
+#include "keypointStore.hpp"
+#include "latencyBudget.hpp"
+#include "featureStore.hpp"
+#include "windowMatching.hpp"
 
 using namespace std;
 
@@ -30,204 +53,440 @@ using namespace std;
 string filename = "PerformanceReport.csv";
 ofstream outputFile(filename, ios::out|ios::trunc);
 
-int main(int argc, const char *argv[])
+// settings shared by all detector/descriptor combinations
+struct SweepSettings {
+
+    const FrameStore *frames;         // decoded grayscale images, shared by all combinations
+    DetectionCache *detections;       // keypoints per detector and frame, shared by all descriptor combinations
+    map<string, int> detectionConsumers; // combinations sharing each detection key, see detectionKey()
+    string binaryMatcherType;         // matcher for binary descriptors: MAT_BF, MAT_FLANN, MAT_SIMD, MAT_GUIDED
+    bool bRoiDetection;               // detect/describe inside the vehicle rectangle only instead of detect-then-filter
+
+    bool bFocusOnVehicle; // only keep keypoints on the preceding vehicle (simulate bounding box)
+    cv::Rect vehicleRect;
+
+    int dataBufferSize; // no. of images which are held in memory (ring buffer) at the same time
+    bool bVis;          // visualize results
+
+    BenchmarkSettings benchmark; // warm-up runs, trials, CPU pinning
+
+    int tileRows, tileCols; // tiled multi-threaded detection if more than one tile
+    int keypointBudget;     // max. keypoints per frame spread over the tiles, 0: unlimited
+    unsigned int tileThreads;
+
+    bool bTracking; // KLT tracking between keyframes instead of detection on every frame
+
+    int detectionScale; // coarse-to-fine detection on the image downsampled by 2 or 4, 1: full resolution
+    bool bSubPixel;     // sub-pixel refinement of corner positions
+
+    bool bQuantizeDescriptors; // SIFT descriptors as 8-bit, matched with the integer SIMD L2 matcher
+
+    int matchWindow; // match against the last n frames in one batched pass, 0: previous frame with the pipeline matcher
+
+    bool bRealTime; // latency budget mode with adaptive detector threshold
+    LatencyBudgetConfig realTime;
+
+    string featureStorePrefix; // write keypoints, descriptors and matches of the last run to <prefix>_<det>_<desc>.feat
+};
+
+// non working detector/descriptor combinations (errors at matching)
+bool isCompatibleCombination(const PerformanceStatistic &combo)
 {
+    return !((combo.detectorType.compare("SHITOMASI") == 0 && combo.descriptorType.compare("BRIEF") == 0)
+             || (combo.detectorType.compare("SHITOMASI") == 0 && combo.descriptorType.compare("ORB") == 0)
+             || (combo.detectorType.compare("SHITOMASI") == 0 && combo.descriptorType.compare("SIFT") == 0)
+             || (combo.detectorType.compare("SHITOMASI") == 0 && combo.descriptorType.compare("AKAZE") == 0)
+             || (combo.detectorType.compare("HARRIS") == 0 && combo.descriptorType.compare("BRIEF") == 0)
+             || (combo.detectorType.compare("HARRIS") == 0 && combo.descriptorType.compare("ORB") == 0)
+             || (combo.detectorType.compare("HARRIS") == 0 && combo.descriptorType.compare("AKAZE") == 0)
+             || (combo.detectorType.compare("HARRIS") == 0 && combo.descriptorType.compare("SIFT") == 0)
+             || (combo.detectorType.compare("HARRIS_FUSED") == 0 && combo.descriptorType.compare("BRIEF") == 0)
+             || (combo.detectorType.compare("HARRIS_FUSED") == 0 && combo.descriptorType.compare("ORB") == 0)
+             || (combo.detectorType.compare("HARRIS_FUSED") == 0 && combo.descriptorType.compare("AKAZE") == 0)
+             || (combo.detectorType.compare("HARRIS_FUSED") == 0 && combo.descriptorType.compare("SIFT") == 0)
+             || (combo.detectorType.compare("FAST") == 0 && combo.descriptorType.compare("BRIEF") == 0)
+             || (combo.detectorType.compare("FAST") == 0 && combo.descriptorType.compare("ORB") == 0)
+             || (combo.detectorType.compare("FAST") == 0 && combo.descriptorType.compare("AKAZE") == 0)
+             || (combo.detectorType.compare("FAST") == 0 && combo.descriptorType.compare("SIFT") == 0)
+             || (combo.detectorType.compare("BRISK") == 0 && combo.descriptorType.compare("BRIEF") == 0)
+             || (combo.detectorType.compare("BRISK") == 0 && combo.descriptorType.compare("ORB") == 0)
+             || (combo.detectorType.compare("BRISK") == 0 && combo.descriptorType.compare("AKAZE") == 0)
+             || (combo.detectorType.compare("BRISK") == 0 && combo.descriptorType.compare("SIFT") == 0)
+             || (combo.detectorType.compare("ORB") == 0 && combo.descriptorType.compare("BRIEF") == 0)
+             || (combo.detectorType.compare("ORB") == 0 && combo.descriptorType.compare("ORB") == 0)
+             || (combo.detectorType.compare("ORB") == 0 && combo.descriptorType.compare("AKAZE") == 0)
+             || (combo.detectorType.compare("ORB") == 0 && combo.descriptorType.compare("SIFT") == 0)
+             || (combo.detectorType.compare("AKAZE") == 0 && combo.descriptorType.compare("BRIEF") == 0)
+             || (combo.detectorType.compare("AKAZE") == 0 && combo.descriptorType.compare("ORB") == 0)
+             || (combo.detectorType.compare("AKAZE") == 0 && combo.descriptorType.compare("SIFT") == 0)
+             || (combo.detectorType.compare("AKAZE") == 0 && combo.descriptorType.compare("AKAZE") == 0)
+             || (combo.detectorType.compare("SIFT") == 0 && combo.descriptorType.compare("BRIEF") == 0)
+             || (combo.detectorType.compare("SIFT") == 0 && combo.descriptorType.compare("ORB") == 0)
+             || (combo.detectorType.compare("SIFT") == 0 && combo.descriptorType.compare("AKAZE") == 0)
+    );
+}
 
-    // #### INIT VARIABLES AND DATA STRUCTURES ####
+// matcher settings used for a detector/descriptor combination
+// quantized SIFT descriptors are matched exactly with the integer SIMD L2 matcher instead of FLANN
+PipelineConfig makePipelineConfig(const string &detectorType, const string &descriptorType, const string &binaryMatcherType, bool bQuantize = false)
+{
+    PipelineConfig pipelineConfig;
+    pipelineConfig.detectorType = detectorTypeFromString(detectorType);       // SHITOMASI, HARRIS, HARRIS_FUSED, FAST, BRISK, ORB, AKAZE, SIFT
+    pipelineConfig.descriptorType = descriptorTypeFromString(descriptorType); // BRISK, BRIEF, ORB, FREAK, AKAZE, SIFT
+    pipelineConfig.descriptorFamily = DescriptorFamily::DES_BINARY;           // DES_BINARY (Binary based: BRIEF, BRISK, ORB, FREAK, KAZE)
+    pipelineConfig.matcherType = matcherTypeFromString(binaryMatcherType);    // MAT_BF (brute force), MAT_FLANN, MAT_SIMD, MAT_GUIDED
+    pipelineConfig.selectorType = SelectorType::SEL_KNN;                      // SEL_NN, SEL_KNN
+    if (pipelineConfig.descriptorType == DescriptorType::SIFT)                // SIFT only works with MAT_FLANN, MAT_SIMD (quantized) or MAT_GUIDED and DES_HOG
+    {
+        pipelineConfig.descriptorFamily = DescriptorFamily::DES_HOG; // DES_HOG (Gradient based, slower type: SIFT)
+        pipelineConfig.bQuantizeDescriptors = bQuantize;
+        if (pipelineConfig.matcherType != MatcherType::MAT_GUIDED)
+            pipelineConfig.matcherType = bQuantize ? MatcherType::MAT_SIMD : MatcherType::MAT_FLANN;
+    }
+    return pipelineConfig;
+}
 
-    // data location
-    string dataPath = "../";
+// the real-time controller retunes the threshold of the combination's own detector, so it does not use tiles
+bool usesTiledDetector(const SweepSettings &settings)
+{
+    return !settings.bRealTime && (settings.tileRows * settings.tileCols > 1 || settings.keypointBudget > 0);
+}
 
-    // camera
-    string imgBasePath = dataPath + "images/";
-    string imgPrefix = "KITTI/2011_09_26/image_00/data/000000"; // left camera, color
-    string imgFileType = ".png";
-    int imgStartIndex = 0; // first file index to load (assumes Lidar and camera names have identical naming convention)
-    int imgEndIndex = 9;   // last file index to load
-    int imgFillWidth = 4;  // no. of digits which make up the file index (e.g. img-0001.png)
+// detection only depends on the detector, descriptor combinations with the same key reuse the result
+string detectionKey(const PerformanceStatistic &combo, const SweepSettings &settings)
+{
+    PipelineConfig pipelineConfig = makePipelineConfig(combo.detectorType, combo.descriptorType, settings.binaryMatcherType, settings.bQuantizeDescriptors);
+    pipelineConfig.detectionScale = settings.detectionScale;
+    bool bRoiDetection = settings.bFocusOnVehicle && settings.bRoiDetection;
+    const cv::Rect &vehicleRect = settings.vehicleRect;
+
+    ostringstream detectorKey;
+    detectorKey << combo.detectorType;
+    if (settings.bFocusOnVehicle)
+        detectorKey << (bRoiDetection ? "@" : "/") << vehicleRect.x << "," << vehicleRect.y << "," << vehicleRect.width << "," << vehicleRect.height;
+    if (settings.detectionScale > 1 || settings.bSubPixel)
+        detectorKey << "|scale " << settings.detectionScale << (settings.bSubPixel ? " subpix" : "");
+    // detector and descriptor of the same type build the scale space once, the cached result then holds descriptors
+    if (FeaturePipeline::sharesScaleSpace(pipelineConfig) && !usesTiledDetector(settings))
+        detectorKey << (pipelineConfig.bQuantizeDescriptors ? "|described 8U" : "|described");
+    if (usesTiledDetector(settings))
+        detectorKey << "|tiles " << settings.tileRows << "x" << settings.tileCols << " budget " << settings.keypointBudget;
+    if (settings.bRealTime) // the threshold depends on the description times, so the detection is not shared
+        detectorKey << "|" << combo.descriptorType;
+    return detectorKey.str();
+}
 
-    // misc
-    int dataBufferSize = 2;       // no. of images which are held in memory (ring buffer) at the same time
-    vector<DataFrame> dataBuffer; // list of data frames which are held in memory at the same time
-    bool bVis = false;            // visualize results
+// Process all frames of one detector/descriptor combination
+// Each call owns its pipeline and ring buffer, so combinations can run on different threads.
+void processCombination(PerformanceStatistic &combo, const SweepSettings &settings)
+{
+    cout << ("Current combo: " + combo.detectorType + " " + combo.descriptorType + "\n") << flush;
 
-    // ### create all detector/descriptor combinations and initialize performance struct
-    vector<string> detectorTypes = {"SHITOMASI", "HARRIS", "FAST", "BRISK", "ORB", "AKAZE", "SIFT"};
-    vector<string> descriptorTypes = {"BRISK", "BRIEF", "ORB", "FREAK", "AKAZE", "SIFT"};
-    vector<PerformanceStatistic> typeCombinations; // performance struct for each detector/descriptor combination (see dataStructures.h)
+    // set up detector, descriptor and matcher once for this combination
+    PipelineConfig pipelineConfig = makePipelineConfig(combo.detectorType, combo.descriptorType, settings.binaryMatcherType, settings.bQuantizeDescriptors);
+    pipelineConfig.detectionScale = settings.detectionScale;
+    pipelineConfig.bSubPixel = settings.bSubPixel;
+    FeaturePipeline pipeline(pipelineConfig);
 
-    for(auto detector = detectorTypes.begin(); detector != detectorTypes.end(); ++detector)
+    // the real-time controller retunes the threshold of this pipeline's detector, so it does not use tiles
+    unique_ptr<TiledDetector> tiledDetector;
+    if (usesTiledDetector(settings))
     {
-        for(auto descriptor = descriptorTypes.begin(); descriptor != descriptorTypes.end(); ++descriptor)
-        {
-            PerformanceStatistic newCombination;
-            newCombination.detectorType = (*detector);
-            newCombination.descriptorType = (*descriptor);
-            for(int i=0; i < 10; i++) // modify if performance test on more than 10 images
-            {
-                newCombination.keypointsTotal[i] = 0;
-                newCombination.keypointsROI[i] = 0;
-                newCombination.keypointsMatched[i] = 0;
-                newCombination.detectionTime[i] = 0.0f;
-                newCombination.descriptionTime[i] = 0.0f;
-            }
-            typeCombinations.push_back(newCombination);
-        }
+        // the sweep thread is pinned to core 0 already, the tile workers take the next cores
+        function<void(unsigned int)> pinWorker;
+        if (settings.benchmark.bPinCpu)
+            pinWorker = [](unsigned int worker) { pinCurrentThread((worker + 1) % max(1u, thread::hardware_concurrency())); };
+        tiledDetector.reset(new TiledDetector(pipelineConfig, settings.tileRows, settings.tileCols, settings.keypointBudget,
+                                              settings.tileThreads, pinWorker));
     }
 
-    // #### Loop over all det/desc combinations ####
-    for(auto currCombo = typeCombinations.begin(); currCombo != typeCombinations.end(); ++currCombo)
+    // batched matching against a window of frames, the ring buffer then keeps the keypoints of all window frames.
+    // The window always searches exhaustively, only the selector is taken from the pipeline (SEL_NN: no ratio test).
+    unique_ptr<KeyframeWindowMatcher> windowMatcher;
+    if (settings.matchWindow > 0)
+        windowMatcher.reset(new KeyframeWindowMatcher(settings.matchWindow, pipeline.normType(),
+                                                      pipelineConfig.selectorType == SelectorType::SEL_KNN ? pipelineConfig.minDescDistRatio : 0.0));
+    RingBuffer<DataFrame> dataBuffer(max(settings.dataBufferSize, settings.matchWindow + 1)); // data frames which are held in memory at the same time
+    bool bVis = settings.bVis;                                   // visualize results
+
+    bool bFocusOnVehicle = settings.bFocusOnVehicle;
+    const cv::Rect &vehicleRect = settings.vehicleRect;
+
+    // detect and describe only inside the rectangle, total keypoints then equal the keypoints in ROI
+    bool bRoiDetection = bFocusOnVehicle && settings.bRoiDetection;
+    vector<cv::Rect> rois(1, vehicleRect);
+    KeypointStore kptStore;   // struct of arrays scratch for the ROI filter and the real-time keypoint limit
+    vector<int> kptSelection; // indices of the keypoints inside the rectangle or among the strongest
+
+    // detect and describe only on keyframes, track with optical flow in between
+    unique_ptr<KltTracker> tracker;
+    if (settings.bTracking)
+        tracker.reset(new KltTracker());
+
+    // real-time mode: adaptive detector threshold, frames are dropped or degraded to meet the latency budget
+    unique_ptr<LatencyBudgetController> budget;
+    double defaultThreshold, minThreshold, maxThreshold;
+    pipeline.detectorThresholdRange(defaultThreshold, minThreshold, maxThreshold);
+    if (settings.bRealTime)
+        budget.reset(new LatencyBudgetController(settings.realTime, defaultThreshold, minThreshold, maxThreshold));
+
+    // detection only depends on the detector, descriptor combinations of the same detector reuse the result
+    // detector and descriptor of the same type build the scale space once, the cached result then holds descriptors
+    bool bSharedScaleSpace = pipeline.sharesScaleSpace() && !tiledDetector;
+    string detectorKey = detectionKey(combo, settings);
+    int detectionConsumers = settings.detectionConsumers.at(detectorKey);
+
+    // #### Warm-up runs, then measured trials over all images ####
+    int runs = settings.benchmark.warmupRuns + settings.benchmark.trials;
+    // keypoints, descriptors and matches of the last run, for replaying matching or downstream jobs
+    unique_ptr<FeatureStoreWriter> featureWriter;
+    if (!settings.featureStorePrefix.empty())
+        featureWriter.reset(new FeatureStoreWriter(settings.featureStorePrefix + "_" + combo.detectorType + "_" + combo.descriptorType + ".feat",
+                                                   pipeline.normType()));
+
+    for (int run = 0; run < runs; run++)
     {
-        // non working detector/descriptor combinations
-        if(((*currCombo).detectorType.compare("SHITOMASI") == 0 && (*currCombo).descriptorType.compare("BRIEF") == 0)
-            || ((*currCombo).detectorType.compare("SHITOMASI") == 0 && (*currCombo).descriptorType.compare("ORB") == 0)
-            || ((*currCombo).detectorType.compare("SHITOMASI") == 0 && (*currCombo).descriptorType.compare("SIFT") == 0)
-            || ((*currCombo).detectorType.compare("SHITOMASI") == 0 && (*currCombo).descriptorType.compare("AKAZE") == 0)
-            || ((*currCombo).detectorType.compare("HARRIS") == 0 && (*currCombo).descriptorType.compare("BRIEF") == 0)
-            || ((*currCombo).detectorType.compare("HARRIS") == 0 && (*currCombo).descriptorType.compare("ORB") == 0)
-            || ((*currCombo).detectorType.compare("HARRIS") == 0 && (*currCombo).descriptorType.compare("AKAZE") == 0)
-            || ((*currCombo).detectorType.compare("HARRIS") == 0 && (*currCombo).descriptorType.compare("SIFT") == 0)
-            || ((*currCombo).detectorType.compare("FAST") == 0 && (*currCombo).descriptorType.compare("BRIEF") == 0)
-            || ((*currCombo).detectorType.compare("FAST") == 0 && (*currCombo).descriptorType.compare("ORB") == 0)
-            || ((*currCombo).detectorType.compare("FAST") == 0 && (*currCombo).descriptorType.compare("AKAZE") == 0)
-            || ((*currCombo).detectorType.compare("FAST") == 0 && (*currCombo).descriptorType.compare("SIFT") == 0)
-            || ((*currCombo).detectorType.compare("BRISK") == 0 && (*currCombo).descriptorType.compare("BRIEF") == 0)
-            || ((*currCombo).detectorType.compare("BRISK") == 0 && (*currCombo).descriptorType.compare("ORB") == 0)
-            || ((*currCombo).detectorType.compare("BRISK") == 0 && (*currCombo).descriptorType.compare("AKAZE") == 0)
-            || ((*currCombo).detectorType.compare("BRISK") == 0 && (*currCombo).descriptorType.compare("SIFT") == 0)
-            || ((*currCombo).detectorType.compare("ORB") == 0 && (*currCombo).descriptorType.compare("BRIEF") == 0)
-            || ((*currCombo).detectorType.compare("ORB") == 0 && (*currCombo).descriptorType.compare("ORB") == 0)
-            || ((*currCombo).detectorType.compare("ORB") == 0 && (*currCombo).descriptorType.compare("AKAZE") == 0)
-            || ((*currCombo).detectorType.compare("ORB") == 0 && (*currCombo).descriptorType.compare("SIFT") == 0)
-            || ((*currCombo).detectorType.compare("AKAZE") == 0 && (*currCombo).descriptorType.compare("BRIEF") == 0)
-            || ((*currCombo).detectorType.compare("AKAZE") == 0 && (*currCombo).descriptorType.compare("ORB") == 0)
-            || ((*currCombo).detectorType.compare("AKAZE") == 0 && (*currCombo).descriptorType.compare("SIFT") == 0)
-            || ((*currCombo).detectorType.compare("AKAZE") == 0 && (*currCombo).descriptorType.compare("AKAZE") == 0)
-            || ((*currCombo).detectorType.compare("SIFT") == 0 && (*currCombo).descriptorType.compare("BRIEF") == 0)
-            || ((*currCombo).detectorType.compare("SIFT") == 0 && (*currCombo).descriptorType.compare("ORB") == 0)
-            || ((*currCombo).detectorType.compare("SIFT") == 0 && (*currCombo).descriptorType.compare("AKAZE") == 0)
-        )
+        bool bMeasured = run >= settings.benchmark.warmupRuns;
+        bool bStoreFeatures = featureWriter && run + 1 == runs;
+        dataBuffer.clear();
+        if (windowMatcher)
+            windowMatcher->clear();
+        if (tracker)
+            tracker->reset();
+        if (budget)
         {
-            continue; // skip non compatible (errors at matching) det/desc combination
+            budget->reset(defaultThreshold);
+            pipeline.setDetectorThreshold(defaultThreshold);
         }
-        cout << "Current combo: " << (*currCombo).detectorType << " " << (*currCombo).descriptorType << endl;
+
+        // every run detects again, so each trial contributes its own detection time sample
+        ostringstream runKeyStream;
+        runKeyStream << detectorKey << "#" << run;
+        string runKey = runKeyStream.str();
+
         // #### Loop over all images ####
-        //for (size_t imgIndex = 0; imgIndex <= imgEndIndex - imgStartIndex; imgIndex++)
-        for (size_t imgIndex = 0; imgIndex < 10; imgIndex++)
+        for (size_t imgIndex = 0; imgIndex < settings.frames->size(); imgIndex++)
         {
-            // #### Load images into ring buffer ####
-            // assemble filenames for current index
-            ostringstream imgNumber;
-            imgNumber << setfill('0') << setw(imgFillWidth) << imgStartIndex + imgIndex;
-            string imgFullFilename = imgBasePath + imgPrefix + imgNumber.str() + imgFileType;
+            TRACE_SCOPE("frame");
+            uint64_t allocationsBefore = threadAllocationCount();
 
-            // convert image to grayscale
-            cv::Mat img, imgGray;
-            img = cv::imread(imgFullFilename);
-            cv::cvtColor(img, imgGray, cv::COLOR_BGR2GRAY);
+            FrameStatistic &frameStat = combo.frames[imgIndex];
 
-            // push image into data frame buffer
-            DataFrame frame;
-            frame.cameraImg = imgGray;
+            // #### REAL-TIME MODE: DROP FRAMES WHICH WOULD MISS THE DEADLINE BY FAR ####
+            bool bTrackFrame = tracker && !tracker->needsKeyframe();
+            if (budget && budget->shouldDrop(!bTrackFrame))
+            {
+                settings.detections->release(runKey, imgIndex, detectionConsumers);
+                if (bMeasured)
+                    frameStat.droppedFrames++;
+                frameStat.allocations = (int)(threadAllocationCount() - allocationsBefore);
+                continue;
+            }
 
-            if(dataBuffer.size() < dataBufferSize)
-                dataBuffer.push_back(frame);
+            // #### Load images into ring buffer ####
+            // grayscale image from the frame store, shares the decoded data
+            const cv::Mat &imgGray = settings.frames->frame(imgIndex);
 
-            else
+            // reuse the slot of the oldest frame once the buffer is full, its vectors keep their capacity
+            DataFrame *slot;
             {
-                dataBuffer.erase(dataBuffer.begin());
-                dataBuffer.push_back(frame);
+                TRACE_SCOPE("ring buffer");
+                slot = &dataBuffer.pushSlot();
+                slot->reset();
+                slot->cameraImg = imgGray;
             }
+            DataFrame &frame = *slot;
 
             //cout << "#1 : LOAD IMAGE INTO BUFFER done" << endl;
 
+            // #### TRACK KEYPOINTS BETWEEN KEYFRAMES ####
+            if (bTrackFrame)
+            {
+                cv::Rect trackingArea = bFocusOnVehicle ? vehicleRect : cv::Rect(cv::Point(0, 0), imgGray.size());
+                double trackingTime = tracker->track(dataBuffer[dataBuffer.size() - 2], frame, trackingArea);
+                settings.detections->release(runKey, imgIndex, detectionConsumers); // the other combinations may detect on this frame
+
+                frameStat.bKeyframe = false;
+                frameStat.keypointsTotal = frame.keypoints.size();
+                frameStat.keypointsROI = frame.keypoints.size();
+                frameStat.keypointsMatched = frame.kptMatches.size();
+                if (bMeasured)
+                {
+                    frameStat.detectionTimes.push_back(trackingTime); // tracking replaces detection and description
+                    frameStat.descriptionTimes.push_back(0.0);
+                    frameStat.combinedTimes.push_back(trackingTime);
+                }
+                if (budget)
+                {
+                    if (bMeasured && trackingTime > settings.realTime.frameBudget)
+                        frameStat.deadlineMisses++;
+                    frameStat.detectorThreshold = pipeline.detectorThreshold();
+                    budget->updateTracked(trackingTime);
+                    pipeline.setDetectorThreshold(budget->threshold());
+                }
+                if (bStoreFeatures)
+                    featureWriter->append((uint32_t)imgIndex, frame);
+                if (windowMatcher) // tracked keypoints carry their keyframe descriptors
+                    windowMatcher->push((int)imgIndex, frame.descriptors);
+                frameStat.allocations = (int)(threadAllocationCount() - allocationsBefore);
+                continue;
+            }
+            frameStat.bKeyframe = true;
+
             // #### DETECT IMAGE KEYPOINTS ####
 
-            vector<cv::KeyPoint> keypoints; // keypoints for current image
-            string detectorType = (*currCombo).detectorType; // detectors: SHITOMASI, HARRIS, FAST, BRISK, ORB, AKAZE, SIFT
             bool visKeypoints = false;
 
-            if (detectorType.compare("SHITOMASI") == 0)
-                (*currCombo).detectionTime[imgIndex] = detKeypointsShiTomasi(keypoints, imgGray, visKeypoints);
-
-            else if(detectorType.compare("HARRIS") == 0)
-                (*currCombo).detectionTime[imgIndex] = detKeypointsHarris(keypoints, imgGray, visKeypoints);
-
-            else
-                (*currCombo).detectionTime[imgIndex] = detKeypointsModern(keypoints, imgGray, detectorType, visKeypoints);
+            const DetectionResult &detection = settings.detections->get(runKey, imgIndex, detectionConsumers, [&](DetectionResult &result) {
+                TRACE_SCOPE("detection");
+                cv::Mat descriptors;
+                if (tiledDetector) // tiles cover the vehicle rectangle or the whole image
+                    result.detectionTime = tiledDetector->detect(result.keypoints, imgGray, bRoiDetection ? vehicleRect : cv::Rect(cv::Point(0, 0), imgGray.size()));
+                else if (bSharedScaleSpace && bRoiDetection)
+                    result.detectionTime = pipeline.detectAndDescribe(result.keypoints, imgGray, rois, descriptors);
+                else if (bSharedScaleSpace)
+                    result.detectionTime = pipeline.detectAndDescribe(result.keypoints, imgGray, descriptors);
+                else if (bRoiDetection)
+                    result.detectionTime = pipeline.detect(result.keypoints, imgGray, rois, visKeypoints);
+                else
+                    result.detectionTime = pipeline.detect(result.keypoints, imgGray, visKeypoints);
+
+                if (bFocusOnVehicle && !bRoiDetection)
+                {
+                    TRACE_SCOPE("ROI filter");
+                    // vectorized rectangle test on the keypoint positions only, then gather the kept keypoints
+                    kptStore.assign(result.keypoints, KeypointStore::FIELD_POSITION);
+                    kptStore.selectInRect(vehicleRect, kptSelection);
+                    result.roiKeypoints.reserve(kptSelection.size());
+                    for (auto it = kptSelection.begin(); it != kptSelection.end(); ++it)
+                    {
+                        result.roiKeypoints.push_back(result.keypoints[*it]);
+                        if (!descriptors.empty())
+                            result.roiDescriptors.push_back(descriptors.row(*it));
+                    }
+                    //cout << "Bounding box focusing removed " << result.keypoints.size() - result.roiKeypoints.size() << " outliers." << endl;
+                }
+                else
+                {
+                    result.roiKeypoints = result.keypoints;
+                    result.roiDescriptors = descriptors;
+                }
+            });
 
-            (*currCombo).keypointsTotal[imgIndex] = keypoints.size();
+            double detectionTime = detection.detectionTime;
+            int keypointsDetected = (int)detection.roiKeypoints.size();
+            frameStat.keypointsTotal = detection.keypoints.size();
+            if (bFocusOnVehicle)
+                frameStat.keypointsROI = detection.roiKeypoints.size();
 
-            // ### optional: only keep keypoints on the preceding vehicle (simulate bounding box)
-            bool bFocusOnVehicle = true;
-            cv::Rect vehicleRect(535, 180, 180, 150);
-            vector<cv::KeyPoint> croppedKeypoints;
+            // the cached result is shared, descriptor extraction may remove keypoints, so copy into the frame's vector
+            {
+                TRACE_SCOPE("copy keypoints");
+                frame.keypoints.assign(detection.roiKeypoints.begin(), detection.roiKeypoints.end());
+            }
 
-            if (bFocusOnVehicle)
+            // real-time mode: only describe as many of the strongest keypoints as the remaining budget allows
+            int keypointLimit = budget && !bSharedScaleSpace ? budget->keypointLimit(detectionTime) : -1;
+            if (keypointLimit >= 0 && (int)frame.keypoints.size() > keypointLimit)
             {
-                for(auto it = keypoints.begin(); it != keypoints.end(); ++it) // cycle through keypoints
-                {
-                    if(vehicleRect.contains((*it).pt))
-                        croppedKeypoints.push_back(*it);
+                if (pipelineConfig.detectorType == DetectorType::SHITOMASI)
+                    frame.keypoints.resize(keypointLimit); // there is no response info, corners are sorted in descending quality order
+                else
+                { // strongest responses, compacted in place and in detection order
+                    kptStore.assign(frame.keypoints, KeypointStore::FIELD_RESPONSE);
+                    kptStore.selectBest(keypointLimit, kptSelection);
+                    for (size_t j = 0; j < kptSelection.size(); j++)
+                        frame.keypoints[j] = frame.keypoints[kptSelection[j]];
+                    frame.keypoints.resize(kptSelection.size());
                 }
-                //cout << "Bounding box focusing removed " << keypoints.size() - croppedKeypoints.size() << " outliers." << endl;
-                (*currCombo).keypointsROI[imgIndex] = croppedKeypoints.size();
-                keypoints = croppedKeypoints; // replace old list
+                if (bMeasured)
+                    frameStat.degradedFrames++;
             }
 
             // ### optional : limit number of keypoints for debugging
             bool bLimitKpts = false;
-            if (bLimitKpts)
+            if (bLimitKpts && !bSharedScaleSpace) // shared descriptors are computed already
             {
                 int maxKeypoints = 30;
 
-                if (detectorType.compare("SHITOMASI") == 0)
+                if (pipelineConfig.detectorType == DetectorType::SHITOMASI)
                 { // there is no response info, so keep the first 50 as they are sorted in descending quality order
-                    keypoints.erase(keypoints.begin() + maxKeypoints, keypoints.end());
+                    frame.keypoints.erase(frame.keypoints.begin() + maxKeypoints, frame.keypoints.end());
                 }
-                cv::KeyPointsFilter::retainBest(keypoints, maxKeypoints);
+                cv::KeyPointsFilter::retainBest(frame.keypoints, maxKeypoints);
                 //cout << " NOTE: Keypoints have been limited!" << endl;
             }
 
-            (dataBuffer.end() - 1)->keypoints = keypoints; // push keypoints and descriptor for current frame to end of data buffer
-
             //cout << "#2 : DETECT KEYPOINTS done" << endl;
 
 
             // #### EXTRACT KEYPOINT DESCRIPTORS ####
 
-            cv::Mat descriptors;
-            string descriptorType = (*currCombo).descriptorType; // BRISK, BRIEF, ORB, FREAK, AKAZE, SIFT
+            // descriptors are written into the frame's buffer, which is reused if size and type match
+            // with a shared scale space the descriptors were computed together with the keypoints, the whole time
+            // counts as detection time
+            double descriptionTime = 0.0;
+            if (bSharedScaleSpace)
+            {
+                TRACE_SCOPE("copy descriptors");
+                detection.roiDescriptors.copyTo(frame.descriptors);
+            }
+            else if (bRoiDetection)
+                descriptionTime = pipeline.describe(frame.keypoints, frame.cameraImg, rois, frame.descriptors);
+            else
+                descriptionTime = pipeline.describe(frame.keypoints, frame.cameraImg, frame.descriptors);
+            settings.detections->release(runKey, imgIndex, detectionConsumers); // the shared result is not used below
 
-            (*currCombo).descriptionTime[imgIndex] = descKeypoints((dataBuffer.end() - 1)->keypoints, (dataBuffer.end() - 1)->cameraImg, descriptors, descriptorType);
+            if (bMeasured)
+            {
+                frameStat.detectionTimes.push_back(detectionTime);
+                frameStat.descriptionTimes.push_back(descriptionTime);
+                frameStat.combinedTimes.push_back(detectionTime + descriptionTime);
+            }
 
-            (*currCombo).combinedTime[imgIndex] = (*currCombo).descriptionTime[imgIndex] + (*currCombo).detectionTime[imgIndex];
-            (dataBuffer.end() - 1)->descriptors = descriptors; // push descriptors for current frame to end of data buffer
+            // real-time mode: count deadline misses and retune the detector for the next frame
+            if (budget)
+            {
+                if (bMeasured && detectionTime + descriptionTime > settings.realTime.frameBudget)
+                    frameStat.deadlineMisses++;
+                frameStat.detectorThreshold = pipeline.detectorThreshold();
+                budget->update(keypointsDetected, (int)frame.keypoints.size(), detectionTime, descriptionTime);
+                pipeline.setDetectorThreshold(budget->threshold());
+            }
 
             //cout << "#3 : EXTRACT DESCRIPTORS done" << endl;
 
-            if (dataBuffer.size() > 1) // only attempt matching if at least two images have been processed
+            if (windowMatcher && windowMatcher->size() > 0)
             {
 
-                // #### MATCH KEYPOINT DESCRIPTORS ####
-
-                vector<cv::DMatch> matches;
-                string matcherType = "MAT_BF";        // MAT_BF (brute force), MAT_FLANN
-                string descriptorType = "DES_BINARY"; // DES_BINARY (Binary based: BRIEF, BRISK, ORB, FREAK, KAZE)
-                if((*currCombo).descriptorType.compare("SIFT") == 0) // SIFT only works with MAT_FLANN and DES_HOG
-                {
-                    descriptorType = "DES_HOG"; // DES_HOG (Gradient based, slower type: SIFT)
-                    matcherType = "MAT_FLANN";
-                }
+                // #### MATCH KEYPOINT DESCRIPTORS AGAINST THE FRAME WINDOW ####
+
+                // every buffered frame entered the window, so its newest frame is the previous frame
+                windowMatcher->match(frame.descriptors, frame.windowMatches);
+                const vector<cv::DMatch> &prevMatches = frame.windowMatches.back();
+                for (auto it = prevMatches.begin(); it != prevMatches.end(); ++it)
+                    frame.kptMatches.push_back(cv::DMatch((*it).queryIdx, (*it).trainIdx, (*it).distance));
+                frameStat.keypointsMatched = frame.kptMatches.size();
+
+                // keypoints lost in the previous frame but found again in an older one extend their tracks
+                vector<char> bMatched(frame.keypoints.size(), 0), bRecovered(frame.keypoints.size(), 0);
+                for (auto it = prevMatches.begin(); it != prevMatches.end(); ++it)
+                    bMatched[(*it).trainIdx] = 1;
+                for (size_t i = 0; i + 1 < frame.windowMatches.size(); i++)
+                    for (auto it = frame.windowMatches[i].begin(); it != frame.windowMatches[i].end(); ++it)
+                        if (!bMatched[(*it).trainIdx])
+                            bRecovered[(*it).trainIdx] = 1;
+                frameStat.keypointsRecovered = (int)count(bRecovered.begin(), bRecovered.end(), 1);
+            }
+            else if (dataBuffer.size() > 1) // only attempt matching if at least two images have been processed
+            {
 
-                string selectorType = "SEL_KNN";       // SEL_NN, SEL_KNN
+                // #### MATCH KEYPOINT DESCRIPTORS ####
 
-                matchDescriptors((dataBuffer.end() - 2)->keypoints, (dataBuffer.end() - 1)->keypoints,
-                                 (dataBuffer.end() - 2)->descriptors, (dataBuffer.end() - 1)->descriptors,
-                                 matches, descriptorType, matcherType, selectorType);
+                DataFrame &prevFrame = dataBuffer[dataBuffer.size() - 2];
+                pipeline.match(prevFrame, frame, frame.kptMatches); // store matches in current data frame
 
-                (*currCombo).keypointsMatched[imgIndex] = matches.size();
-                (dataBuffer.end() - 1)->kptMatches = matches; // store matches in current data frame
+                frameStat.keypointsMatched = frame.kptMatches.size();
 
                 //cout << "#4 : MATCH KEYPOINT DESCRIPTORS done" << endl;
 
@@ -235,10 +494,10 @@ int main(int argc, const char *argv[])
                 //bVis = true;
                 if (bVis)
                 {
-                    cv::Mat matchImg = ((dataBuffer.end() - 1)->cameraImg).clone();
-                    cv::drawMatches((dataBuffer.end() - 2)->cameraImg, (dataBuffer.end() - 2)->keypoints,
-                                    (dataBuffer.end() - 1)->cameraImg, (dataBuffer.end() - 1)->keypoints,
-                                    matches, matchImg,
+                    cv::Mat matchImg = (frame.cameraImg).clone();
+                    cv::drawMatches(prevFrame.cameraImg, prevFrame.keypoints,
+                                    frame.cameraImg, frame.keypoints,
+                                    frame.kptMatches, matchImg,
                                     cv::Scalar::all(-1), cv::Scalar::all(-1),
                                     vector<char>(), cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
 
@@ -251,54 +510,339 @@ int main(int argc, const char *argv[])
                 bVis = false;
             }
 
+            if (tracker)
+                tracker->setKeyframe(frame);
+            if (bStoreFeatures)
+                featureWriter->append((uint32_t)imgIndex, frame);
+            if (windowMatcher)
+                windowMatcher->push((int)imgIndex, frame.descriptors);
+
+            frameStat.allocations = (int)(threadAllocationCount() - allocationsBefore);
+
         } // end of images loop
-    } // end of combo loop
 
-    // #### Performance Report
-    outputFile  << "Detector Type" << ","
-                << "DescriptorType" << ","
-                << "Frame" << ","
-                << "Total Keypoints" << ","
-                << "Keypoints in ROI" << ","
-                << "Keypoints in ROI matched" << ","
-                << "Time for detection [ms]" << ","
-                << "Time for description [ms]" << ","
-                << "Combined Time [ms]" << ","
-                << endl;
-
-    for(auto it = typeCombinations.begin(); it != typeCombinations.end(); ++it)
+    } // end of runs loop
+
+    if (budget)
     {
-        for(int i = 0; i < 10; i++)
+        int misses = 0, dropped = 0, degraded = 0, measured = 0;
+        for (auto it = combo.frames.begin(); it != combo.frames.end(); ++it)
         {
-            if((*it).keypointsTotal[i] == 0) // combination was not compatible
-            {
-                outputFile  << (*it).detectorType << ","
-                            << (*it).descriptorType << ","
-                            << "N/A" << ","
-                            << "N/A" << ","
-                            << "N/A" << ","
-                            << "N/A" << ","
-                            << "N/A" << ","
-                            << "N/A" << ","
-                            << "N/A" << ","
-                            << endl;
-            }
+            misses += (*it).deadlineMisses;
+            dropped += (*it).droppedFrames;
+            degraded += (*it).degradedFrames;
+            measured += (int)(*it).combinedTimes.size() + (*it).droppedFrames;
+        }
+        ostringstream summary;
+        summary << combo.detectorType << " " << combo.descriptorType << ": " << misses << " deadline misses, " << dropped
+                << " dropped, " << degraded << " degraded of " << measured << " measured frames\n";
+        cout << summary.str() << flush;
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+
+    // #### INIT VARIABLES AND DATA STRUCTURES ####
 
+    // data location
+    string dataPath = "../";
+
+    // camera
+    string imgBasePath = dataPath + "images/";
+    string imgPrefix = "KITTI/2011_09_26/image_00/data/000000"; // left camera, color
+    string imgFileType = ".png";
+    int imgStartIndex = 0; // first file index to load (assumes Lidar and camera names have identical naming convention)
+    int imgEndIndex = 9;   // last file index to load, run with --frames <count> to change
+    int imgFillWidth = 4;  // no. of digits which make up the file index (e.g. img-0001.png)
+    string sourceSpec;     // other sequences (image glob, KITTI drive, video, raw dump), run with --source <spec>
+    size_t frameLimit = 0; // frames taken from --source, 0: all
+    size_t prefetchDepth = 4; // frames decoded ahead of the detect stage of --stream, --prefetch <frames>, 0: decode in place
+    size_t frameMemory = 2048; // [MB] decoded frames the sweep keeps in RAM before spilling to disk, --frame-memory <MB>
+
+    // misc
+    int dataBufferSize = 2;       // no. of images which are held in memory (ring buffer) at the same time
+    bool bVis = false;            // visualize results
+
+    // sweep mode, run with --parallel [numThreads] to process combinations concurrently
+    bool bParallel = false;
+    unsigned int numThreads = thread::hardware_concurrency();
+    string frameCacheFile; // raw grayscale cache, run with --frame-cache <file> to skip PNG decoding on later runs
+    bool bStream = false;  // streaming mode for a single combination, run with --stream <detector> <descriptor>
+    string streamDetector, streamDescriptor;
+    string binaryMatcherType = "MAT_BF"; // matcher for binary descriptors, select with --matcher <MAT_BF|MAT_FLANN|MAT_SIMD|MAT_GUIDED>
+    bool bRoiDetection = false;          // run with --roi-detect to detect/describe inside the vehicle rectangle only
+
+    // benchmark, run with --warmup <runs> --trials <runs> --pin, JSON report with --json <file>
+    BenchmarkSettings benchmark;
+    string jsonFilename = "PerformanceReport.json";
+    int tileRows = 1, tileCols = 1; // tiled detection, run with --tiles <rows>x<cols> [--tile-threads <n>]
+    int keypointBudget = 0;         // keypoints per frame spread evenly over the tiles, run with --kpt-budget <n>
+    unsigned int tileThreads = thread::hardware_concurrency();
+    bool bTracking = false;         // KLT tracking between keyframes, run with --track
+    int detectionScale = 1;         // coarse-to-fine detection, run with --detect-scale <2|4>
+    bool bSubPixel = false;         // sub-pixel corner refinement at full resolution, run with --subpix
+    bool bQuantizeDescriptors = false; // 8-bit SIFT descriptors with exact SIMD L2 matching, run with --quantize
+    int matchWindow = 0;            // batched matching against the last n frames, run with --match-window <n>
+    bool bRealTime = false;         // latency budget mode, run with --realtime <ms> [--target-kpts <n>]
+    LatencyBudgetConfig realTime;
+    string featureStorePrefix;      // feature store files, write with --features <prefix>
+    string traceFilename; // Chrome trace of all stages with --trace <file>, needs a build with ENABLE_TRACING
+    for (int i = 1; i < argc; i++)
+    {
+        if (string(argv[i]).compare("--parallel") == 0)
+        {
+            bParallel = true;
+            if (i + 1 < argc && isdigit(argv[i + 1][0]))
+                numThreads = atoi(argv[++i]);
+        }
+        else if (string(argv[i]).compare("--frame-cache") == 0 && i + 1 < argc)
+            frameCacheFile = argv[++i];
+        else if (string(argv[i]).compare("--matcher") == 0 && i + 1 < argc)
+            binaryMatcherType = argv[++i];
+        else if (string(argv[i]).compare("--roi-detect") == 0)
+            bRoiDetection = true;
+        else if (string(argv[i]).compare("--frames") == 0 && i + 1 < argc)
+        {
+            frameLimit = max(1, atoi(argv[++i]));
+            imgEndIndex = imgStartIndex + (int)frameLimit - 1;
+        }
+        else if (string(argv[i]).compare("--source") == 0 && i + 1 < argc)
+            sourceSpec = argv[++i];
+        else if (string(argv[i]).compare("--prefetch") == 0 && i + 1 < argc)
+            prefetchDepth = max(0, atoi(argv[++i]));
+        else if (string(argv[i]).compare("--frame-memory") == 0 && i + 1 < argc)
+            frameMemory = max(0, atoi(argv[++i]));
+        else if (string(argv[i]).compare("--warmup") == 0 && i + 1 < argc)
+            benchmark.warmupRuns = max(0, atoi(argv[++i]));
+        else if (string(argv[i]).compare("--trials") == 0 && i + 1 < argc)
+            benchmark.trials = max(1, atoi(argv[++i]));
+        else if (string(argv[i]).compare("--pin") == 0)
+            benchmark.bPinCpu = true;
+        else if (string(argv[i]).compare("--json") == 0 && i + 1 < argc)
+            jsonFilename = argv[++i];
+        else if (string(argv[i]).compare("--tiles") == 0 && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%dx%d", &tileRows, &tileCols) != 2 || tileRows < 1 || tileCols < 1)
+                tileRows = tileCols = 1;
+        }
+        else if (string(argv[i]).compare("--tile-threads") == 0 && i + 1 < argc)
+            tileThreads = max(1, atoi(argv[++i]));
+        else if (string(argv[i]).compare("--kpt-budget") == 0 && i + 1 < argc)
+            keypointBudget = max(0, atoi(argv[++i]));
+        else if (string(argv[i]).compare("--track") == 0)
+            bTracking = true;
+        else if (string(argv[i]).compare("--detect-scale") == 0 && i + 1 < argc)
+        {
+            detectionScale = atoi(argv[++i]);
+            if (detectionScale != 2 && detectionScale != 4)
+                detectionScale = 1;
+        }
+        else if (string(argv[i]).compare("--subpix") == 0)
+            bSubPixel = true;
+        else if (string(argv[i]).compare("--quantize") == 0)
+            bQuantizeDescriptors = true;
+        else if (string(argv[i]).compare("--match-window") == 0 && i + 1 < argc)
+            matchWindow = max(0, atoi(argv[++i]));
+        else if (string(argv[i]).compare("--realtime") == 0 && i + 1 < argc)
+        {
+            bRealTime = true;
+            realTime.frameBudget = max(0.1, atof(argv[++i]));
+        }
+        else if (string(argv[i]).compare("--features") == 0 && i + 1 < argc)
+            featureStorePrefix = argv[++i];
+        else if (string(argv[i]).compare("--target-kpts") == 0 && i + 1 < argc)
+            realTime.targetKeypoints = max(1, atoi(argv[++i]));
+        else if (string(argv[i]).compare("--trace") == 0 && i + 1 < argc)
+            traceFilename = argv[++i];
+        else if (string(argv[i]).compare("--stream") == 0 && i + 2 < argc)
+        {
+            bStream = true;
+            streamDetector = argv[++i];
+            streamDescriptor = argv[++i];
+        }
+    }
+
+    setTraceThreadName("main");
+
+    // #### Frame source ####
+    // the project's KITTI images by default, assemble filenames for all indices
+    vector<string> imgFilenames;
+    if (sourceSpec.empty())
+    {
+        for (int imgIndex = imgStartIndex; imgIndex <= imgEndIndex; imgIndex++)
+        {
+            ostringstream imgNumber;
+            imgNumber << setfill('0') << setw(imgFillWidth) << imgIndex;
+            imgFilenames.push_back(imgBasePath + imgPrefix + imgNumber.str() + imgFileType);
+        }
+    }
+
+    // opened only when frames are actually decoded, a mapped source has nothing to prefetch
+    auto openSource = [&](size_t prefetch) {
+        unique_ptr<FrameSource> source;
+        if (sourceSpec.empty())
+            source.reset(new ImageListSource(imgFilenames));
+        else
+            source = openFrameSource(sourceSpec);
+        if (prefetch > 0 && !source->isMapped())
+            source.reset(new PrefetchFrameSource(move(source), prefetch));
+        return source;
+    };
+
+    // #### Streaming mode: one combination, stages run concurrently on consecutive frames ####
+    if (bStream)
+    {
+        cv::Rect vehicleRect(535, 180, 180, 150);
+        PipelineConfig streamConfig = makePipelineConfig(streamDetector, streamDescriptor, binaryMatcherType, bQuantizeDescriptors);
+        streamConfig.detectionScale = detectionScale;
+        streamConfig.bSubPixel = bSubPixel;
+        StreamPipeline stream(streamConfig, vehicleRect);
+
+        unique_ptr<FrameSource> frameSource = openSource(prefetchDepth);
+        stream.run(
+            [&frameSource, frameLimit](size_t frameIndex, cv::Mat &img) {
+                if (frameLimit > 0 && frameIndex >= frameLimit)
+                    return false;
+                return frameSource->read(img);
+            },
+            [](const StreamItem &item) {
+                cout << "Frame " << item.frameIndex << ": " << item.keypointsTotal << " keypoints, "
+                     << item.frame.keypoints.size() << " in ROI, " << item.frame.kptMatches.size() << " matched" << endl;
+            });
+
+        stream.printStatistics(cout);
+        if (!traceFilename.empty() && !writeChromeTrace(traceFilename))
+            cout << "Trace not written, build with -DENABLE_TRACING=ON" << endl;
+        return 0;
+    }
+
+    // #### Load all images once ####
+    // every combination runs over all frames, so they are decoded up front and there is no work to overlap the
+    // decoding with, the sweep reads without prefetching
+    // the frame source must outlive the store, frames of a raw dump point into its mapping
+    unique_ptr<FrameSource> frameSource;
+    FrameStore frameStore;
+    {
+        TRACE_SCOPE("load frames");
+        bool bCacheFrames = !frameCacheFile.empty() && sourceSpec.empty();
+        if (!bCacheFrames || !frameStore.mapCache(imgFilenames, frameCacheFile))
+        {
+            frameSource = openSource(0);
+            if (bCacheFrames)
+                frameStore.loadAndCache(*frameSource, imgFilenames, frameCacheFile);
             else
-            {
-                outputFile  << (*it).detectorType << ","
-                            << (*it).descriptorType << ","
-                            << i << ","
-                            << (*it).keypointsTotal[i] << ","
-                            << (*it).keypointsROI[i] << ","
-                            << (*it).keypointsMatched[i] << ","
-                            << (*it).detectionTime[i] << ","
-                            << (*it).descriptionTime[i] << ","
-                            << (*it).combinedTime[i] << ","
-                            << endl;
-            }
+                frameStore.load(*frameSource, frameLimit, frameMemory << 20);
+        }
+    }
+    if (!frameCacheFile.empty() && !sourceSpec.empty())
+        cout << "--frame-cache applies to the default images only, map a dump with --source raw:<file>" << endl;
+    if (frameStore.size() == 0)
+    {
+        cout << "No frames to process" << endl;
+        return 1;
+    }
+    benchmark.frameCount = frameStore.size();
+
+    DetectionCache detectionCache;
+
+    SweepSettings settings;
+    settings.frames = &frameStore;
+    settings.detections = &detectionCache;
+    settings.binaryMatcherType = binaryMatcherType;
+    settings.bRoiDetection = bRoiDetection;
+    settings.bFocusOnVehicle = true; // only keep keypoints on the preceding vehicle (simulate bounding box)
+    settings.vehicleRect = cv::Rect(535, 180, 180, 150);
+    settings.dataBufferSize = dataBufferSize;
+    settings.bVis = bVis && !bParallel; // no windows from worker threads
+    settings.benchmark = benchmark;
+    settings.tileRows = tileRows;
+    settings.tileCols = tileCols;
+    settings.keypointBudget = keypointBudget;
+    // combinations of a parallel sweep already keep every core busy, their tiles run on the combination's thread
+    settings.tileThreads = bParallel ? 1 : tileThreads;
+    settings.bTracking = bTracking;
+    settings.detectionScale = detectionScale;
+    settings.bSubPixel = bSubPixel;
+    settings.bQuantizeDescriptors = bQuantizeDescriptors;
+    settings.matchWindow = matchWindow;
+    settings.bRealTime = bRealTime;
+    settings.realTime = realTime;
+    settings.featureStorePrefix = featureStorePrefix;
+
+    // ### create all detector/descriptor combinations and initialize performance struct
+    vector<string> detectorTypes = {"SHITOMASI", "HARRIS", "HARRIS_FUSED", "FAST", "BRISK", "ORB", "AKAZE", "SIFT"};
+    vector<string> descriptorTypes = {"BRISK", "BRIEF", "ORB", "FREAK", "AKAZE", "SIFT"};
+    vector<PerformanceStatistic> typeCombinations; // performance struct for each detector/descriptor combination (see dataStructures.h)
+
+    for(auto detector = detectorTypes.begin(); detector != detectorTypes.end(); ++detector)
+    {
+        for(auto descriptor = descriptorTypes.begin(); descriptor != descriptorTypes.end(); ++descriptor)
+        {
+            PerformanceStatistic newCombination;
+            newCombination.detectorType = (*detector);
+            newCombination.descriptorType = (*descriptor);
+            newCombination.frames.resize(frameStore.size());
+            typeCombinations.push_back(newCombination);
+        }
+    }
+
+    // the cache frees a frame's detection once every combination sharing the key is done with it
+    for (auto currCombo = typeCombinations.begin(); currCombo != typeCombinations.end(); ++currCombo)
+        if (isCompatibleCombination(*currCombo))
+            settings.detectionConsumers[detectionKey(*currCombo, settings)]++;
+
+    // #### Loop over all det/desc combinations ####
+    if (bParallel)
+    {
+        // cap OpenCV's internal threading, every combination runs single threaded on its own core
+        // so per-combination timings stay comparable with each other
+        cv::setNumThreads(1);
+        cout << "Parallel sweep on " << numThreads << " threads" << endl;
+
+        function<void(unsigned int)> pinWorker;
+        if (benchmark.bPinCpu)
+            pinWorker = [](unsigned int worker) { pinCurrentThread(worker % max(1u, thread::hardware_concurrency())); };
+        ThreadPool pool(numThreads, pinWorker);
+        for(auto currCombo = typeCombinations.begin(); currCombo != typeCombinations.end(); ++currCombo)
+        {
+            if (!isCompatibleCombination(*currCombo))
+                continue; // skip non compatible (errors at matching) det/desc combination
+
+            PerformanceStatistic *combo = &(*currCombo);
+            pool.submit([combo, &settings] { processCombination(*combo, settings); });
         }
+        pool.wait();
     }
+
+    else
+    {
+        if (benchmark.bPinCpu)
+        {
+            // threads inherit the affinity of the thread creating them, so OpenCV's worker threads are started
+            // before this thread is pinned, otherwise they would all share its core
+            cv::parallel_for_(cv::Range(0, cv::getNumThreads()), [](const cv::Range &) {});
+            if (!pinCurrentThread(0))
+                cout << "CPU pinning not available" << endl;
+        }
+
+        for(auto currCombo = typeCombinations.begin(); currCombo != typeCombinations.end(); ++currCombo)
+        {
+            if (!isCompatibleCombination(*currCombo))
+                continue; // skip non compatible (errors at matching) det/desc combination
+
+            processCombination(*currCombo, settings);
+        }
+    }
+
+    // #### Performance Report
+    writeCsvReport(outputFile, typeCombinations);
+
+    ofstream jsonFile(jsonFilename, ios::out|ios::trunc);
+    writeJsonReport(jsonFile, typeCombinations, benchmark);
+
+    if (!traceFilename.empty() && !writeChromeTrace(traceFilename))
+        cout << "Trace not written, build with -DENABLE_TRACING=ON" << endl;
     outputFile.close();
 
     return 0;
@@ -0,0 +1,38 @@
+#include <cstdlib>
+#include <new>
+
+#include "allocationCounter.hpp"
+
+using namespace std;
+
+// per thread, so concurrently processed combinations do not count each other's allocations
+static thread_local uint64_t allocations = 0;
+
+uint64_t threadAllocationCount()
+{
+    return allocations;
+}
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *ptr = malloc(size > 0 ? size : 1);
+    if (!ptr)
+        throw bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
@@ -0,0 +1,12 @@
+#ifndef allocationCounter_hpp
+#define allocationCounter_hpp
+
+#include <cstdint>
+
+
+// Number of operator new calls made by the calling thread so far
+// The global operator new/delete are replaced in allocationCounter.cpp, so this counts every std container and
+// std::shared_ptr allocation. cv::Mat buffers come from cv::fastMalloc and are not included.
+uint64_t threadAllocationCount();
+
+#endif /* allocationCounter_hpp */
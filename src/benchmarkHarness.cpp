@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "benchmarkHarness.hpp"
+
+using namespace std;
+
+// #### Statistics ####
+
+static double percentile(const vector<double> &sorted, double p)
+{
+    double rank = p * (sorted.size() - 1);
+    size_t lower = (size_t)floor(rank);
+    size_t upper = min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (rank - lower) * (sorted[upper] - sorted[lower]);
+}
+
+SampleSummary summarize(std::vector<double> samples)
+{
+    SampleSummary summary;
+    summary.samples = samples.size();
+    if (samples.empty())
+        return summary;
+
+    sort(samples.begin(), samples.end());
+    summary.min = samples.front();
+    summary.max = samples.back();
+    summary.median = percentile(samples, 0.5);
+    summary.p95 = percentile(samples, 0.95);
+    summary.p99 = percentile(samples, 0.99);
+
+    summary.mean = accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    if (samples.size() > 1)
+    {
+        double sumSq = 0.0;
+        for (auto it = samples.begin(); it != samples.end(); ++it)
+            sumSq += (*it - summary.mean) * (*it - summary.mean);
+        summary.stddev = sqrt(sumSq / (samples.size() - 1));
+    }
+    return summary;
+}
+
+bool pinCurrentThread(unsigned int cpu)
+{
+#if defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+
+// #### CSV report ####
+
+void writeCsvReport(std::ostream &os, const std::vector<PerformanceStatistic> &combinations)
+{
+    os  << "Detector Type" << ","
+        << "DescriptorType" << ","
+        << "Frame" << ","
+        << "Total Keypoints" << ","
+        << "Keypoints in ROI" << ","
+        << "Keypoints in ROI matched" << ","
+        << "Time for detection [ms]" << ","
+        << "Time for description [ms]" << ","
+        << "Combined Time [ms]" << ","
+        << "Combined Time p95 [ms]" << ","
+        << "Combined Time stddev [ms]" << ","
+        << "Allocations" << ","
+        << endl;
+
+    for(auto it = combinations.begin(); it != combinations.end(); ++it)
+    {
+        for(size_t i = 0; i < (*it).frames.size(); i++)
+        {
+            const FrameStatistic &frame = (*it).frames[i];
+            if(frame.combinedTimes.empty()) // combination was not compatible
+            {
+                os  << (*it).detectorType << ","
+                    << (*it).descriptorType << ","
+                    << i << ",";
+                for (int col = 0; col < 9; col++)
+                    os << "N/A" << ",";
+                os << endl;
+            }
+
+            else
+            {
+                SampleSummary combined = summarize(frame.combinedTimes);
+                os  << (*it).detectorType << ","
+                    << (*it).descriptorType << ","
+                    << i << ","
+                    << frame.keypointsTotal << ","
+                    << frame.keypointsROI << ","
+                    << frame.keypointsMatched << ","
+                    << summarize(frame.detectionTimes).median << ","
+                    << summarize(frame.descriptionTimes).median << ","
+                    << combined.median << ","
+                    << combined.p95 << ","
+                    << combined.stddev << ","
+                    << frame.allocations << ","
+                    << endl;
+            }
+        }
+    }
+}
+
+
+// #### JSON report ####
+
+static string jsonString(const string &str)
+{
+    string quoted = "\"";
+    for (auto it = str.begin(); it != str.end(); ++it)
+    {
+        if (*it == '"' || *it == '\\')
+            quoted += '\\';
+        quoted += *it;
+    }
+    return quoted + "\"";
+}
+
+static void writeSummary(std::ostream &os, const SampleSummary &summary)
+{
+    os << "{\"samples\": " << summary.samples << ", \"mean\": " << summary.mean << ", \"stddev\": " << summary.stddev
+       << ", \"min\": " << summary.min << ", \"median\": " << summary.median << ", \"p95\": " << summary.p95
+       << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << "}";
+}
+
+void writeJsonReport(std::ostream &os, const std::vector<PerformanceStatistic> &combinations, const BenchmarkSettings &settings)
+{
+    os << setprecision(6);
+    os << "{\n";
+    os << "  \"settings\": {\"frames\": " << settings.frameCount << ", \"warmupRuns\": " << settings.warmupRuns
+       << ", \"trials\": " << settings.trials << ", \"pinCpu\": " << (settings.bPinCpu ? "true" : "false") << "},\n";
+    os << "  \"combinations\": [";
+
+    for (auto it = combinations.begin(); it != combinations.end(); ++it)
+    {
+        // all samples of the combination, over frames and trials
+        vector<double> detection, description, combined;
+        int deadlineMisses = 0, droppedFrames = 0, degradedFrames = 0;
+        for (auto frame = (*it).frames.begin(); frame != (*it).frames.end(); ++frame)
+        {
+            deadlineMisses += (*frame).deadlineMisses;
+            droppedFrames += (*frame).droppedFrames;
+            degradedFrames += (*frame).degradedFrames;
+            detection.insert(detection.end(), (*frame).detectionTimes.begin(), (*frame).detectionTimes.end());
+            description.insert(description.end(), (*frame).descriptionTimes.begin(), (*frame).descriptionTimes.end());
+            combined.insert(combined.end(), (*frame).combinedTimes.begin(), (*frame).combinedTimes.end());
+        }
+
+        os << (it == combinations.begin() ? "\n" : ",\n");
+        os << "    {\"detector\": " << jsonString((*it).detectorType) << ", \"descriptor\": " << jsonString((*it).descriptorType)
+           << ", \"compatible\": " << (combined.empty() ? "false" : "true") << ",\n";
+        os << "     \"detectionTime\": ";
+        writeSummary(os, summarize(detection));
+        os << ",\n     \"descriptionTime\": ";
+        writeSummary(os, summarize(description));
+        os << ",\n     \"combinedTime\": ";
+        writeSummary(os, summarize(combined));
+        os << ",\n     \"deadlineMisses\": " << deadlineMisses << ", \"droppedFrames\": " << droppedFrames
+           << ", \"degradedFrames\": " << degradedFrames;
+        os << ",\n     \"frames\": [";
+
+        for (size_t i = 0; !combined.empty() && i < (*it).frames.size(); i++)
+        {
+            const FrameStatistic &frame = (*it).frames[i];
+            os << (i == 0 ? "\n" : ",\n");
+            os << "       {\"frame\": " << i << ", \"keypointsTotal\": " << frame.keypointsTotal
+               << ", \"keypointsROI\": " << frame.keypointsROI << ", \"keypointsMatched\": " << frame.keypointsMatched
+               << ", \"keypointsRecovered\": " << frame.keypointsRecovered
+               << ", \"allocations\": " << frame.allocations << ", \"keyframe\": " << (frame.bKeyframe ? "true" : "false")
+               << ",\n        \"deadlineMisses\": " << frame.deadlineMisses << ", \"droppedFrames\": " << frame.droppedFrames
+               << ", \"degradedFrames\": " << frame.degradedFrames << ", \"detectorThreshold\": " << frame.detectorThreshold
+               << ",\n        \"detectionTime\": ";
+            writeSummary(os, summarize(frame.detectionTimes));
+            os << ",\n        \"descriptionTime\": ";
+            writeSummary(os, summarize(frame.descriptionTimes));
+            os << ",\n        \"combinedTime\": ";
+            writeSummary(os, summarize(frame.combinedTimes));
+            os << "}";
+        }
+        os << "]}";
+    }
+    os << "\n  ]\n}\n";
+}
@@ -0,0 +1,39 @@
+#ifndef benchmarkHarness_hpp
+#define benchmarkHarness_hpp
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "dataStructures.h"
+
+
+struct BenchmarkSettings {
+
+    int frameCount = 10; // no. of images processed per trial
+    int warmupRuns = 0;  // passes over all frames before measuring (page faults, lazy OpenCV init, cold caches)
+    int trials = 1;      // measured passes, every frame gets one timing sample per trial
+    bool bPinCpu = false; // pin every worker thread to its own core
+};
+
+// distribution of timing samples [ms]
+struct SampleSummary {
+
+    size_t samples = 0;
+    double mean = 0.0, stddev = 0.0; // sample standard deviation
+    double min = 0.0, median = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+};
+
+// percentiles interpolate linearly between the closest ranks
+SampleSummary summarize(std::vector<double> samples);
+
+// pin the calling thread to one core, returns false if not supported on this platform or the call failed
+bool pinCurrentThread(unsigned int cpu);
+
+// one row per combination and frame with the median times, the timing spread is in the JSON report
+void writeCsvReport(std::ostream &os, const std::vector<PerformanceStatistic> &combinations);
+
+// settings, per frame and per combination summaries of all timing samples
+void writeJsonReport(std::ostream &os, const std::vector<PerformanceStatistic> &combinations, const BenchmarkSettings &settings);
+
+#endif /* benchmarkHarness_hpp */
@@ -1,6 +1,7 @@
 #ifndef dataStructures_h
 #define dataStructures_h
 
+#include <string>
 #include <vector>
 #include <opencv2/core.hpp>
 
@@ -12,21 +13,49 @@ struct DataFrame { // represents the available sensor information at the same ti
     std::vector<cv::KeyPoint> keypoints; // 2D keypoints within camera image
     cv::Mat descriptors; // keypoint descriptors
     std::vector<cv::DMatch> kptMatches; // keypoint matches between previous and current frame
+    std::vector<cv::Point2f> kptMotion; // displacement of each keypoint since the previous frame, filled by guided matching and tracking
+    std::vector<std::vector<cv::DMatch>> windowMatches; // matches of the older frames of the matching window, oldest first,
+                                                        // queryIdx: older keypoint, trainIdx: this frame's keypoint, imgIdx: frame index
+
+    // prepare for reuse by a new frame, containers keep their capacity and the descriptor buffer is overwritten
+    void reset()
+    {
+        cameraImg.release();
+        keypoints.clear();
+        kptMatches.clear();
+        kptMotion.clear();
+        for (auto it = windowMatches.begin(); it != windowMatches.end(); ++it)
+            (*it).clear();
+    }
 };
 
-struct PerformanceStatistic {
+struct FrameStatistic { // results for one frame of a detector/descriptor combination
+
+    int keypointsTotal = 0;
+    int keypointsROI = 0;
+    int keypointsMatched = 0; // for project, use BF matching and descriptor distance ratio 0.8
+    int keypointsRecovered = 0; // matched to an older frame of the matching window, but not to the previous frame
+    int allocations = 0;      // operator new calls while processing the frame
+    bool bKeyframe = true;    // false if the keypoints were tracked from the previous frame instead of detected
+
+    // real-time mode, counted over the measured trials
+    int deadlineMisses = 0;   // detection + description exceeded the frame budget
+    int droppedFrames = 0;    // skipped because the predicted time was far beyond the budget
+    int degradedFrames = 0;   // keypoints were cut to fit the remaining budget
+    double detectorThreshold = 0.0; // threshold the frame was detected with (last run)
+
+    // [ms], one sample per measured trial
+    std::vector<double> detectionTimes;
+    std::vector<double> descriptionTimes;
+    std::vector<double> combinedTimes;
+};
 
-    int keypointsTotal[10];
-    int keypointsROI[10];
-    int keypointsMatched[10]; // for project, use BF matching and descriptor distance ratio 0.8
+struct PerformanceStatistic {
 
     std::string detectorType;
     std::string descriptorType;
 
-    double detectionTime[10];
-    double descriptionTime[10];
-    double combinedTime[10];
-
+    std::vector<FrameStatistic> frames; // one entry per frame, no timing samples if the combination was skipped
 };
 
 #endif /* dataStructures_h */
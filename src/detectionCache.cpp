@@ -0,0 +1,46 @@
+#include "detectionCache.hpp"
+
+using namespace std;
+
+DetectionCache::Entry &DetectionCache::entry(const std::string &configKey, size_t frameIndex, int consumers)
+{
+    unique_ptr<Entry> &slot = entries[make_pair(configKey, frameIndex)];
+    if (!slot)
+    {
+        slot.reset(new Entry());
+        slot->pending = consumers;
+    }
+    return *slot;
+}
+
+const DetectionResult &DetectionCache::get(const std::string &configKey, size_t frameIndex, int consumers, const DetectFunction &detect)
+{
+    Entry *cached;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        cached = &entry(configKey, frameIndex, consumers);
+    }
+
+    // detection runs outside the lock, so different keys are computed concurrently
+    call_once(cached->once, [&] { detect(cached->result); });
+    return cached->result;
+}
+
+void DetectionCache::release(const std::string &configKey, size_t frameIndex, int consumers)
+{
+    lock_guard<std::mutex> lock(mutex);
+    if (--entry(configKey, frameIndex, consumers).pending <= 0)
+        entries.erase(make_pair(configKey, frameIndex));
+}
+
+size_t DetectionCache::size()
+{
+    lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+void DetectionCache::clear()
+{
+    lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
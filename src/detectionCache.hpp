@@ -0,0 +1,55 @@
+#ifndef detectionCache_hpp
+#define detectionCache_hpp
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+
+struct DetectionResult { // keypoint detection of one frame, shared by all descriptor combinations
+
+    std::vector<cv::KeyPoint> keypoints;    // all keypoints in the frame
+    std::vector<cv::KeyPoint> roiKeypoints; // keypoints kept after ROI filtering
+    cv::Mat roiDescriptors;                 // descriptors of roiKeypoints if detection and description share a scale space
+    double detectionTime = 0.0;             // [ms], measured when the result was computed
+};
+
+// Detection results by detector configuration and frame index
+// Detection only depends on the detector, so every descriptor combination of a detector reuses the same result.
+// The first caller for a key runs the detection, concurrent callers for the same key wait for it.
+// consumers is the number of combinations sharing a key. Each of them releases every frame once when it is done
+// with it, also frames it never requested (dropped or tracked frames), the last release frees the entry. So only
+// the frames some combination has not reached yet are held, not the whole sequence.
+class DetectionCache
+{
+public:
+    typedef std::function<void(DetectionResult &result)> DetectFunction;
+
+    // configKey must identify everything that changes the result (detector type, parameters, ROI)
+    // the reference is valid until the caller releases the frame
+    const DetectionResult &get(const std::string &configKey, size_t frameIndex, int consumers, const DetectFunction &detect);
+    void release(const std::string &configKey, size_t frameIndex, int consumers);
+
+    size_t size(); // frames currently held
+    void clear();
+
+private:
+    struct Entry {
+        std::once_flag once;
+        DetectionResult result;
+        int pending; // consumers which have not released the frame yet
+    };
+
+    Entry &entry(const std::string &configKey, size_t frameIndex, int consumers); // caller holds the mutex
+
+    std::mutex mutex;
+    std::map<std::pair<std::string, size_t>, std::unique_ptr<Entry>> entries; // entries never move, references stay valid
+};
+
+#endif /* detectionCache_hpp */
@@ -0,0 +1,1034 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/xfeatures2d.hpp>
+#include <opencv2/xfeatures2d/nonfree.hpp>
+
+#include "featurePipeline.hpp"
+#include "keypointNMS.hpp"
+#include "simdMatching.hpp"
+#include "tracing.hpp"
+
+using namespace std;
+
+// #### String conversion ####
+
+DetectorType detectorTypeFromString(const std::string &name)
+{
+    if (name.compare("SHITOMASI") == 0) return DetectorType::SHITOMASI;
+    if (name.compare("HARRIS") == 0) return DetectorType::HARRIS;
+    if (name.compare("HARRIS_FUSED") == 0) return DetectorType::HARRIS_FUSED;
+    if (name.compare("FAST") == 0) return DetectorType::FAST;
+    if (name.compare("BRISK") == 0) return DetectorType::BRISK;
+    if (name.compare("ORB") == 0) return DetectorType::ORB;
+    if (name.compare("AKAZE") == 0) return DetectorType::AKAZE;
+    if (name.compare("SIFT") == 0) return DetectorType::SIFT;
+    throw invalid_argument("unknown detector type: " + name);
+}
+
+DescriptorType descriptorTypeFromString(const std::string &name)
+{
+    if (name.compare("BRISK") == 0) return DescriptorType::BRISK;
+    if (name.compare("BRIEF") == 0) return DescriptorType::BRIEF;
+    if (name.compare("ORB") == 0) return DescriptorType::ORB;
+    if (name.compare("FREAK") == 0) return DescriptorType::FREAK;
+    if (name.compare("AKAZE") == 0) return DescriptorType::AKAZE;
+    if (name.compare("SIFT") == 0) return DescriptorType::SIFT;
+    throw invalid_argument("unknown descriptor type: " + name);
+}
+
+DescriptorFamily descriptorFamilyFromString(const std::string &name)
+{
+    if (name.compare("DES_BINARY") == 0) return DescriptorFamily::DES_BINARY;
+    if (name.compare("DES_HOG") == 0) return DescriptorFamily::DES_HOG;
+    throw invalid_argument("unknown descriptor family: " + name);
+}
+
+MatcherType matcherTypeFromString(const std::string &name)
+{
+    if (name.compare("MAT_BF") == 0) return MatcherType::MAT_BF;
+    if (name.compare("MAT_FLANN") == 0) return MatcherType::MAT_FLANN;
+    if (name.compare("MAT_SIMD") == 0) return MatcherType::MAT_SIMD;
+    if (name.compare("MAT_GUIDED") == 0) return MatcherType::MAT_GUIDED;
+    throw invalid_argument("unknown matcher type: " + name);
+}
+
+SelectorType selectorTypeFromString(const std::string &name)
+{
+    if (name.compare("SEL_NN") == 0) return SelectorType::SEL_NN;
+    if (name.compare("SEL_KNN") == 0) return SelectorType::SEL_KNN;
+    throw invalid_argument("unknown selector type: " + name);
+}
+
+std::string toString(DetectorType type)
+{
+    switch (type)
+    {
+    case DetectorType::SHITOMASI: return "SHITOMASI";
+    case DetectorType::HARRIS: return "HARRIS";
+    case DetectorType::HARRIS_FUSED: return "HARRIS_FUSED";
+    case DetectorType::FAST: return "FAST";
+    case DetectorType::BRISK: return "BRISK";
+    case DetectorType::ORB: return "ORB";
+    case DetectorType::AKAZE: return "AKAZE";
+    case DetectorType::SIFT: return "SIFT";
+    }
+    return "";
+}
+
+std::string toString(DescriptorType type)
+{
+    switch (type)
+    {
+    case DescriptorType::BRISK: return "BRISK";
+    case DescriptorType::BRIEF: return "BRIEF";
+    case DescriptorType::ORB: return "ORB";
+    case DescriptorType::FREAK: return "FREAK";
+    case DescriptorType::AKAZE: return "AKAZE";
+    case DescriptorType::SIFT: return "SIFT";
+    }
+    return "";
+}
+
+std::string toString(DescriptorFamily family)
+{
+    return family == DescriptorFamily::DES_BINARY ? "DES_BINARY" : "DES_HOG";
+}
+
+std::string toString(MatcherType type)
+{
+    switch (type)
+    {
+    case MatcherType::MAT_BF: return "MAT_BF";
+    case MatcherType::MAT_FLANN: return "MAT_FLANN";
+    case MatcherType::MAT_SIMD: return "MAT_SIMD";
+    case MatcherType::MAT_GUIDED: return "MAT_GUIDED";
+    }
+    return "";
+}
+
+std::string toString(SelectorType type)
+{
+    return type == SelectorType::SEL_NN ? "SEL_NN" : "SEL_KNN";
+}
+
+DescriptorFamily descriptorFamilyOf(DescriptorType type)
+{
+    return type == DescriptorType::SIFT ? DescriptorFamily::DES_HOG : DescriptorFamily::DES_BINARY;
+}
+
+
+// #### Pipeline setup ####
+
+FeaturePipeline::FeaturePipeline(const PipelineConfig &config) : cfg(config)
+{
+    if (cfg.detectionScale != 1 && cfg.detectionScale != 2 && cfg.detectionScale != 4)
+        throw invalid_argument("detectionScale must be 1, 2 or 4");
+
+    double minThreshold, maxThreshold;
+    detectorThresholdRange(detThreshold, minThreshold, maxThreshold);
+    createDetector();
+
+    // select appropriate descriptor
+    switch (cfg.descriptorType)
+    {
+    case DescriptorType::BRISK:
+    {
+        int threshold = 30;        // FAST/AGAST detection threshold score.
+        int octaves = 3;           // detection octaves (use 0 to do single scale)
+        float patternScale = 1.0f; // apply this scale to the pattern used for sampling the neighbourhood of a keypoint.
+        extractor = cv::BRISK::create(threshold, octaves, patternScale);
+        break;
+    }
+
+    case DescriptorType::BRIEF:
+        extractor = cv::xfeatures2d::BriefDescriptorExtractor::create();
+        break;
+
+    case DescriptorType::ORB:
+        extractor = cv::ORB::create();
+        break;
+
+    case DescriptorType::FREAK:
+        extractor = cv::xfeatures2d::FREAK::create();
+        break;
+
+    case DescriptorType::AKAZE:
+        extractor = cv::AKAZE::create();
+        break;
+
+    case DescriptorType::SIFT:
+        extractor = cv::xfeatures2d::SIFT::create();
+        break;
+    }
+
+    // one object for detection and description, its detectAndCompute builds the scale space only once
+    if (sharesScaleSpace())
+        extractor = detector;
+
+    // configure matcher
+    bool crossCheck = false;
+    if (cfg.matcherType == MatcherType::MAT_BF || cfg.matcherType == MatcherType::MAT_GUIDED) // brute force matching
+    {
+        matcher = cv::BFMatcher::create(normType(), crossCheck);
+    }
+    else if (cfg.matcherType == MatcherType::MAT_FLANN)
+    { // binary descriptors use the native Hamming LSH index instead of FLANN on converted float descriptors
+        if (cfg.descriptorFamily == DescriptorFamily::DES_HOG)
+            matcher = cv::DescriptorMatcher::create(cv::DescriptorMatcher::FLANNBASED);
+    }
+    else if (cfg.descriptorFamily != DescriptorFamily::DES_BINARY && !cfg.bQuantizeDescriptors) // MAT_SIMD, native matcher without OpenCV object
+    {
+        throw invalid_argument("MAT_SIMD requires binary (DES_BINARY) or quantized descriptors");
+    }
+}
+
+
+// default and useful range of the detector threshold, higher values always give fewer keypoints
+void FeaturePipeline::detectorThresholdRange(double &defaultThreshold, double &minThreshold, double &maxThreshold) const
+{
+    switch (cfg.detectorType)
+    {
+    case DetectorType::SHITOMASI: // quality level, fraction of the best corner's eigenvalue
+        defaultThreshold = 0.01, minThreshold = 0.001, maxThreshold = 0.5;
+        break;
+    case DetectorType::HARRIS: // min. response in the 8 bit scaled response matrix
+    case DetectorType::HARRIS_FUSED:
+        defaultThreshold = 100, minThreshold = 1, maxThreshold = 254;
+        break;
+    case DetectorType::FAST: // intensity difference between center and circle pixels
+    case DetectorType::BRISK:
+        defaultThreshold = 30, minThreshold = 5, maxThreshold = 120;
+        break;
+    case DetectorType::ORB: // FAST threshold of the pyramid levels
+        defaultThreshold = 20, minThreshold = 5, maxThreshold = 120;
+        break;
+    case DetectorType::AKAZE: // detector response threshold
+        defaultThreshold = 0.001, minThreshold = 1e-5, maxThreshold = 0.05;
+        break;
+    case DetectorType::SIFT: // contrast threshold
+        defaultThreshold = 0.04, minThreshold = 0.005, maxThreshold = 0.3;
+        break;
+    }
+}
+
+void FeaturePipeline::createDetector()
+{
+    // Several modern (2006-2012) OpenCV feature/keypoint detector methods
+    // See https://docs.opencv.org/master/d0/d13/classcv_1_1Feature2D.html
+    // (!) SIFT and SURF are patented and not freely available for commercial applications
+    switch (cfg.detectorType)
+    {
+    case DetectorType::SHITOMASI:
+    case DetectorType::HARRIS:
+    case DetectorType::HARRIS_FUSED:
+        break; // implemented with cv::goodFeaturesToTrack / cv::cornerHarris / FusedHarris, no detector object
+
+    case DetectorType::FAST:
+    {
+        int threshold = cvRound(detThreshold); // difference between intensity of the central pixel and pixels of a circle around this pixel
+        bool bNMS = true;   // perform non-maxima suppression on keypoints
+        cv::FastFeatureDetector::DetectorType type = cv::FastFeatureDetector::TYPE_9_16; // TYPE_9_16, TYPE_7_12, TYPE_5_8
+        detector = cv::FastFeatureDetector::create(threshold, bNMS, type);
+        break;
+    }
+
+    case DetectorType::BRISK:
+        detector = cv::BRISK::create(cvRound(detThreshold));
+        break;
+
+    case DetectorType::ORB:
+    {
+        int fastThreshold = cvRound(detThreshold);
+        detector = cv::ORB::create(500, 1.2f, 8, 31, 0, 2, cv::ORB::HARRIS_SCORE, 31, fastThreshold);
+        break;
+    }
+
+    case DetectorType::AKAZE:
+        detector = cv::AKAZE::create(cv::AKAZE::DESCRIPTOR_MLDB, 0, 3, (float)detThreshold);
+        break;
+
+    case DetectorType::SIFT:
+        detector = cv::xfeatures2d::SIFT::create(0, 3, detThreshold);
+        break;
+    }
+}
+
+void FeaturePipeline::setDetectorThreshold(double threshold)
+{
+    double defaultThreshold, minThreshold, maxThreshold;
+    detectorThresholdRange(defaultThreshold, minThreshold, maxThreshold);
+    threshold = min(maxThreshold, max(minThreshold, threshold));
+    if (threshold == detThreshold)
+        return;
+
+    // OpenCV 4.1 has no threshold setters for BRISK and SIFT, the detector objects are cheap to create
+    detThreshold = threshold;
+    createDetector();
+    if (sharesScaleSpace())
+        extractor = detector;
+}
+
+
+// #### Keypoint detection ####
+
+double FeaturePipeline::detect(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, bool bVis)
+{
+    TRACE_SCOPE("detect");
+    double t = detectInImage(keypoints, img);
+    //cout << toString(cfg.detectorType) << " detection with n= " << keypoints.size() << " keypoints in " << t << " ms" << endl;
+
+    // visualize keypoints
+    if (bVis)
+        visualizeKeypoints(keypoints, img, vector<cv::Rect>());
+
+    return t;
+}
+
+// index of the first rectangle containing the point, -1 if there is none
+static int owningRoi(const std::vector<cv::Rect> &rois, const cv::Point2f &pt)
+{
+    for (size_t k = 0; k < rois.size(); k++)
+        if (rois[k].contains(pt))
+            return (int)k;
+    return -1;
+}
+
+// rectangle grown by border on every side, clipped to the image
+static cv::Rect expandRoi(const cv::Rect &roi, int border, const cv::Size &imgSize)
+{
+    cv::Rect expanded(roi.x - border, roi.y - border, roi.width + 2 * border, roi.height + 2 * border);
+    return expanded & cv::Rect(cv::Point(0, 0), imgSize);
+}
+
+double FeaturePipeline::detect(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois, bool bVis)
+{
+    TRACE_SCOPE("detect ROI");
+    double t = (double)cv::getTickCount();
+
+    int border = detectionBorder();
+    for (size_t k = 0; k < rois.size(); k++)
+    {
+        cv::Rect window = expandRoi(rois[k] & cv::Rect(cv::Point(0, 0), img.size()), border, img.size());
+        if (window.area() == 0)
+            continue;
+
+        // the sub-image is a view into the full image, so filters read the real pixels around the window
+        // instead of extrapolating them
+        roiKeypoints.clear();
+        detectInImage(roiKeypoints, img(window));
+
+        // back to full image coordinates, keep only the keypoints this rectangle owns
+        for (auto it = roiKeypoints.begin(); it != roiKeypoints.end(); ++it)
+        {
+            (*it).pt += cv::Point2f((float)window.x, (float)window.y);
+            if (owningRoi(rois, (*it).pt) == (int)k)
+                keypoints.push_back(*it);
+        }
+    }
+
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+
+    // visualize keypoints
+    if (bVis)
+        visualizeKeypoints(keypoints, img, rois);
+
+    return t;
+}
+
+bool FeaturePipeline::usesRelativeThreshold() const
+{
+    switch (cfg.detectorType)
+    {
+    case DetectorType::SHITOMASI:
+    case DetectorType::HARRIS:
+    case DetectorType::HARRIS_FUSED:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool FeaturePipeline::measureResponseRange(const cv::Mat &img, const cv::Rect &roi, double &minResponse, double &maxResponse)
+{
+    if (!usesRelativeThreshold())
+        return false;
+
+    // a ROI detection which stops after the response, so the window and scale handling are the same as detect()'s
+    bMeasureResponse = true;
+    bResponseReady = false;
+    measuredMin = DBL_MAX, measuredMax = -DBL_MAX;
+    vector<cv::KeyPoint> none;
+    detect(none, img, vector<cv::Rect>(1, roi));
+    bMeasureResponse = false;
+
+    if (measuredMin > measuredMax)
+        return false;
+    minResponse = measuredMin;
+    maxResponse = measuredMax;
+    return true;
+}
+
+void FeaturePipeline::setResponseRange(double minResponse, double maxResponse)
+{
+    bFixedRange = true;
+    responseMin = minResponse;
+    responseMax = maxResponse;
+}
+
+void FeaturePipeline::clearResponseRange()
+{
+    bFixedRange = false;
+    bResponseReady = false;
+}
+
+void FeaturePipeline::updateResponseRange(double minResponse, double maxResponse)
+{
+    measuredMin = min(measuredMin, minResponse);
+    measuredMax = max(measuredMax, maxResponse);
+    bResponseReady = true;
+}
+
+// Coarse-to-fine detection: the detector runs on the image downsampled by detectionScale, which cuts its cost by
+// about the square of the factor. Corners are then relocated with cornerSubPix at full resolution, so they end up
+// more accurate than the integer positions of a full resolution Harris / FAST run.
+double FeaturePipeline::detectInImage(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img)
+{
+    if (cfg.detectionScale == 1 && !cfg.bSubPixel)
+        return detectNative(keypoints, img);
+
+    double t = (double)cv::getTickCount();
+    size_t first = keypoints.size();
+    int scale = cfg.detectionScale;
+    if (scale == 1)
+        detectNative(keypoints, img);
+    else
+    {
+        TRACE_SCOPE("detect coarse");
+        // box filter over scale x scale blocks, cropped to a multiple of the scale so every coarse pixel covers whole
+        // pixels and its center maps to scale * x + (scale - 1) / 2
+        cv::Mat cropped = img(cv::Rect(0, 0, img.cols / scale * scale, img.rows / scale * scale));
+        if (cropped.empty())
+            return 0.0;
+        cv::resize(cropped, coarseImg, cv::Size(cropped.cols / scale, cropped.rows / scale), 0, 0, cv::INTER_AREA);
+
+        coarseKeypoints.clear();
+        detectNative(coarseKeypoints, coarseImg);
+
+        float offset = 0.5f * (scale - 1);
+        keypoints.reserve(first + coarseKeypoints.size());
+        for (auto it = coarseKeypoints.begin(); it != coarseKeypoints.end(); ++it)
+        {
+            (*it).pt = (*it).pt * (float)scale + cv::Point2f(offset, offset);
+            (*it).size *= scale;
+            keypoints.push_back(*it);
+        }
+    }
+
+    if (refinesCorners())
+        refineCorners(keypoints, first, img);
+
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
+
+double FeaturePipeline::detectNative(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img)
+{
+    if (cfg.detectorType == DetectorType::SHITOMASI)
+        return detectShiTomasi(keypoints, img);
+
+    if (cfg.detectorType == DetectorType::HARRIS)
+        return detectHarris(keypoints, img);
+
+    if (cfg.detectorType == DetectorType::HARRIS_FUSED)
+        return detectHarrisFused(keypoints, img);
+
+    double t = (double)cv::getTickCount();
+    detector->detect(img, keypoints);
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
+
+// single scale corner detectors, the scale space detectors interpolate their extrema themselves
+bool FeaturePipeline::refinesCorners() const
+{
+    switch (cfg.detectorType)
+    {
+    case DetectorType::SHITOMASI:
+    case DetectorType::HARRIS:
+    case DetectorType::HARRIS_FUSED:
+    case DetectorType::FAST:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void FeaturePipeline::refineCorners(std::vector<cv::KeyPoint> &keypoints, size_t first, const cv::Mat &img)
+{
+    TRACE_SCOPE("refine corners");
+    if (keypoints.size() == first)
+        return;
+
+    // the window covers the coarse quantization (+-scale / 2 px) plus the detector's own localisation error:
+    // 5x5 at full resolution, 7x7 at 2x and 11x11 at 4x
+    int halfWindow = cfg.detectionScale + 1;
+    subPixCorners.clear();
+    for (auto it = keypoints.begin() + first; it != keypoints.end(); ++it)
+        subPixCorners.push_back((*it).pt);
+
+    cv::TermCriteria criteria(cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 20, 0.01);
+    cv::cornerSubPix(img, subPixCorners, cv::Size(halfWindow, halfWindow), cv::Size(-1, -1), criteria);
+
+    // on edges and in flat areas the iteration can run away, such keypoints keep their detected position
+    float maxShift = (float)halfWindow;
+    for (size_t i = 0; i < subPixCorners.size(); i++)
+    {
+        cv::KeyPoint &kpt = keypoints[first + i];
+        cv::Point2f shift = subPixCorners[i] - kpt.pt;
+        if (shift.x * shift.x + shift.y * shift.y <= maxShift * maxShift)
+            kpt.pt = subPixCorners[i];
+    }
+}
+
+void FeaturePipeline::visualizeKeypoints(const std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois)
+{
+    cv::Mat visImage = img.clone();
+    cv::drawKeypoints(img, keypoints, visImage, cv::Scalar::all(-1), cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
+    for (auto it = rois.begin(); it != rois.end(); ++it)
+        cv::rectangle(visImage, *it, cv::Scalar(0, 255, 0));
+
+    string windowName = toString(cfg.detectorType) + " Detector Results";
+    cv::namedWindow(windowName, 6);
+    imshow(windowName, visImage);
+    cv::waitKey(0);
+}
+
+int FeaturePipeline::detectionBorder() const
+{
+    int border;
+    switch (cfg.detectorType)
+    {
+    case DetectorType::SHITOMASI:
+        border = 8; // blockSize 4 + Sobel aperture, min. distance between corners
+        break;
+    case DetectorType::HARRIS:
+    case DetectorType::HARRIS_FUSED:
+        border = 8; // blockSize 2 + Sobel aperture 3, NMS reach 2 * apertureSize
+        break;
+    case DetectorType::FAST:
+        border = 4; // Bresenham circle of radius 3, 3x3 non-maximum suppression
+        break;
+    default:
+        // BRISK, ORB, AKAZE, SIFT: ORB edge threshold (31 px) / scale space filter support at the finest scales.
+        // Keypoints of coarse octaves close to the rectangle edge can still differ from full image detection.
+        border = 32;
+        break;
+    }
+
+    // the border is measured in coarse pixels, the sub-pixel window reads a few more full resolution pixels
+    border *= cfg.detectionScale;
+    if (refinesCorners() && (cfg.bSubPixel || cfg.detectionScale > 1))
+        border += cfg.detectionScale + 2;
+    return border;
+}
+
+// Detect keypoints in image using the traditional Shi-Thomasi detector
+double FeaturePipeline::detectShiTomasi(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img)
+{
+    TRACE_SCOPE("Shi-Tomasi");
+    // compute detector parameters based on image size
+    int blockSize = 4;       //  size of an average block for computing a derivative covariation matrix over each pixel neighborhood
+    double maxOverlap = 0.0; // max. permissible overlap between two features in %
+    double minDistance = (1.0 - maxOverlap) * blockSize;
+    int maxCorners = img.rows * img.cols / max(1.0, minDistance); // max. num. of keypoints
+
+    double qualityLevel = detThreshold; // minimal accepted quality of image corners (default 0.01)
+    double k = 0.04;
+
+    // Apply corner detection
+    double t = (double)cv::getTickCount();
+    corners.clear();
+    if (bMeasureResponse || bFixedRange)
+    {
+        // goodFeaturesToTrack in two steps, the quality is relative to the response range set by the caller
+        if (!bResponseReady)
+            cv::cornerMinEigenVal(img, shiTomasiResponse, blockSize, 3);
+        bResponseReady = false;
+        if (bMeasureResponse)
+        {
+            double minVal, maxVal;
+            cv::minMaxLoc(shiTomasiResponse, &minVal, &maxVal);
+            updateResponseRange(minVal, maxVal);
+            return 0.0;
+        }
+        selectShiTomasiCorners(qualityLevel * responseMax, minDistance, maxCorners);
+    }
+    else
+        cv::goodFeaturesToTrack(img, corners, maxCorners, qualityLevel, minDistance, cv::Mat(), blockSize, false, k);
+
+    // add corners to result vector
+    keypoints.reserve(keypoints.size() + corners.size());
+    for (auto it = corners.begin(); it != corners.end(); ++it)
+    {
+        cv::KeyPoint newKeyPoint;
+        newKeyPoint.pt = cv::Point2f((*it).x, (*it).y);
+        newKeyPoint.size = blockSize;
+        keypoints.push_back(newKeyPoint);
+    }
+
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
+
+// corner selection of goodFeaturesToTrack on shiTomasiResponse: local maxima above minEigenVal, strongest first,
+// each at least minDistance away from all stronger corners
+void FeaturePipeline::selectShiTomasiCorners(double minEigenVal, double minDistance, int maxCorners)
+{
+    cv::threshold(shiTomasiResponse, shiTomasiThresholded, minEigenVal, 0, cv::THRESH_TOZERO);
+    cv::dilate(shiTomasiThresholded, shiTomasiDilated, cv::Mat());
+
+    const int width = shiTomasiResponse.cols, height = shiTomasiResponse.rows;
+    shiTomasiCandidates.clear();
+    for (int y = 1; y < height - 1; y++)
+    {
+        const float *val = shiTomasiThresholded.ptr<float>(y);
+        const float *dil = shiTomasiDilated.ptr<float>(y);
+        for (int x = 1; x < width - 1; x++)
+            if (val[x] != 0 && val[x] == dil[x])
+                shiTomasiCandidates.push_back(make_pair(val[x], y * width + x));
+    }
+    // ties in the order of goodFeaturesToTrack, which sorts pointers into the response
+    sort(shiTomasiCandidates.begin(), shiTomasiCandidates.end(), [](const pair<float, int> &a, const pair<float, int> &b) {
+        return a.first > b.first || (a.first == b.first && a.second > b.second);
+    });
+
+    // grid of the accepted corners with a cell size of minDistance, a corner only competes with its neighbour cells
+    int cellSize = max(1, cvRound(minDistance));
+    int gridWidth = (width + cellSize - 1) / cellSize, gridHeight = (height + cellSize - 1) / cellSize;
+    vector<vector<cv::Point2f>> grid(gridWidth * gridHeight);
+    double minDistSq = minDistance * minDistance;
+    for (auto it = shiTomasiCandidates.begin(); it != shiTomasiCandidates.end() && (int)corners.size() < maxCorners; ++it)
+    {
+        int x = (*it).second % width, y = (*it).second / width;
+        int cx = x / cellSize, cy = y / cellSize;
+        bool bGood = true;
+        for (int gy = max(0, cy - 1); gy <= min(gridHeight - 1, cy + 1) && bGood; gy++)
+        {
+            for (int gx = max(0, cx - 1); gx <= min(gridWidth - 1, cx + 1) && bGood; gx++)
+            {
+                const vector<cv::Point2f> &cell = grid[gy * gridWidth + gx];
+                for (auto pt = cell.begin(); pt != cell.end(); ++pt)
+                {
+                    float dx = x - (*pt).x, dy = y - (*pt).y;
+                    if (dx * dx + dy * dy < minDistSq)
+                    {
+                        bGood = false;
+                        break;
+                    }
+                }
+            }
+        }
+        if (bGood)
+        {
+            grid[cy * gridWidth + cx].push_back(cv::Point2f((float)x, (float)y));
+            corners.push_back(cv::Point2f((float)x, (float)y));
+        }
+    }
+}
+
+double FeaturePipeline::detectHarris(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img)
+{
+    TRACE_SCOPE("Harris");
+    // Detector parameters
+    int blockSize = 2;     // for every pixel, a blockSize × blockSize neighborhood is considered
+    int apertureSize = 3;  // aperture parameter for Sobel operator (must be odd)
+    int minResponse = cvRound(detThreshold); // minimum value for a corner in the 8bit scaled response matrix (default 100)
+    double k = 0.04;       // Harris parameter (see equation for details)
+
+    // Detect Harris corners and normalize output
+    double t = (double)cv::getTickCount(); // timer begin
+
+    if (!bResponseReady)
+        cv::cornerHarris(img, harrisResponse, blockSize, apertureSize, k, cv::BORDER_DEFAULT);
+    bResponseReady = false;
+    if (bMeasureResponse)
+    {
+        double minVal, maxVal;
+        cv::minMaxLoc(harrisResponse, &minVal, &maxVal);
+        updateResponseRange(minVal, maxVal);
+        return 0.0;
+    }
+    if (bFixedRange)
+    {
+        // same mapping as NORM_MINMAX, with the range set by the caller
+        double range = responseMax - responseMin;
+        double scale = range > DBL_EPSILON ? 255.0 / range : 0.0;
+        harrisResponse.convertTo(harrisResponseNorm, CV_32F, scale, -responseMin * scale);
+    }
+    else
+        cv::normalize(harrisResponse, harrisResponseNorm, 0, 255, cv::NORM_MINMAX, CV_32FC1, cv::Mat());
+
+    // Look for prominent corners and instantiate keypoints
+    double maxOverlap = 0.0; // max. permissible overlap between two features in %, used during non-maxima suppression
+    KeypointGridNMS nms(keypoints, img.size(), 2 * apertureSize, maxOverlap);
+    for (int j = 0; j < harrisResponseNorm.rows; j++)
+    {
+        const float *rowPtr = harrisResponseNorm.ptr<float>(j);
+        for (int i = 0; i < harrisResponseNorm.cols; i++)
+        {
+            int response = (int)rowPtr[i];
+            if (response > minResponse)
+            { // only store points above a threshold
+
+                cv::KeyPoint newKeyPoint;
+                newKeyPoint.pt = cv::Point2f(i, j);
+                newKeyPoint.size = 2 * apertureSize;
+                newKeyPoint.response = response;
+
+                // perform non-maximum suppression (NMS) against keypoints in neighbouring grid cells
+                nms.insert(newKeyPoint);
+            }
+        } // eof loop over cols
+    }     // eof loop over rows
+
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
+
+
+// Same detector as detectHarris, gradients, structure tensor, response and thresholding fused into FusedHarris
+double FeaturePipeline::detectHarrisFused(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img)
+{
+    TRACE_SCOPE("Harris fused");
+
+    // Detector parameters, fixed blockSize 2 and Sobel apertureSize 3 (see harrisFused.hpp)
+    int apertureSize = 3;  // aperture parameter for Sobel operator
+    int minResponse = cvRound(detThreshold); // minimum value for a corner in the 8bit scaled response matrix (default 100)
+    double k = 0.04;       // Harris parameter (see equation for details)
+    double maxOverlap = 0.0; // max. permissible overlap between two features in %, used during non-maxima suppression
+
+    double t = (double)cv::getTickCount();
+    if (bMeasureResponse || bFixedRange)
+    {
+        if (!bResponseReady)
+            fusedHarris.computeResponse(img, k);
+        bResponseReady = false;
+        if (bMeasureResponse)
+        {
+            if (fusedHarris.responseMin() <= fusedHarris.responseMax())
+                updateResponseRange(fusedHarris.responseMin(), fusedHarris.responseMax());
+            return 0.0;
+        }
+        fusedHarris.extract(keypoints, minResponse, 2 * apertureSize, maxOverlap, responseMin, responseMax);
+    }
+    else
+        fusedHarris.detect(keypoints, img, k, minResponse, 2 * apertureSize, maxOverlap);
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
+
+
+// #### Keypoint description ####
+
+// Use one of several types of state-of-art descriptors to uniquely identify keypoints
+double FeaturePipeline::describe(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, cv::Mat &descriptors)
+{
+    TRACE_SCOPE("describe");
+    // perform feature description
+    double t = (double)cv::getTickCount();
+    extractor->compute(img, keypoints, descriptors);
+    quantize(descriptors);
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    //cout << toString(cfg.descriptorType) << " descriptor extraction in " << t << " ms" << endl;
+
+    return t;
+}
+
+double FeaturePipeline::describe(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois, cv::Mat &descriptors)
+{
+    TRACE_SCOPE("describe ROI");
+    double t = (double)cv::getTickCount();
+
+    describedKeypoints.clear();
+    roiDescriptorParts.resize(rois.size());
+    int rows = 0, cols = 0, type = -1;
+    for (size_t k = 0; k < rois.size(); k++)
+    {
+        cv::Mat &part = roiDescriptorParts[k];
+        roiKeypoints.clear();
+        for (auto it = keypoints.begin(); it != keypoints.end(); ++it)
+            if (owningRoi(rois, (*it).pt) == (int)k)
+                roiKeypoints.push_back(*it);
+        if (roiKeypoints.empty())
+        {
+            part.release();
+            continue;
+        }
+
+        // extract on the rectangle grown by the sampling pattern radius, in sub-image coordinates
+        cv::Rect window = expandRoi(rois[k], descriptionBorder(roiKeypoints), img.size());
+        cv::Point2f offset((float)window.x, (float)window.y);
+        for (auto it = roiKeypoints.begin(); it != roiKeypoints.end(); ++it)
+            (*it).pt -= offset;
+
+        extractor->compute(img(window), roiKeypoints, part); // may remove keypoints
+
+        for (auto it = roiKeypoints.begin(); it != roiKeypoints.end(); ++it)
+        {
+            (*it).pt += offset;
+            describedKeypoints.push_back(*it);
+        }
+        if (part.rows > 0)
+        {
+            rows += part.rows;
+            cols = part.cols;
+            type = part.type();
+        }
+    }
+    keypoints.swap(describedKeypoints);
+
+    // the caller's buffer is only reallocated if size or type change
+    if (rows == 0)
+        descriptors.release();
+    else
+    {
+        descriptors.create(rows, cols, type);
+        int row = 0;
+        for (auto it = roiDescriptorParts.begin(); it != roiDescriptorParts.end(); ++it)
+        {
+            if ((*it).rows == 0)
+                continue;
+            cv::Mat block = descriptors.rowRange(row, row + (*it).rows);
+            (*it).copyTo(block);
+            row += (*it).rows;
+        }
+    }
+
+    quantize(descriptors);
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
+
+// 8-bit gradient descriptors, a quarter of the memory and integer SIMD distances (see quantizeDescriptors)
+void FeaturePipeline::quantize(cv::Mat &descriptors) const
+{
+    if (!cfg.bQuantizeDescriptors || descriptors.depth() != CV_32F)
+        return;
+    cv::Mat floatDescriptors = descriptors; // keeps the float rows alive while the output is reallocated
+    quantizeDescriptors(floatDescriptors, descriptors);
+}
+
+int FeaturePipeline::normType() const
+{
+    return cfg.descriptorFamily == DescriptorFamily::DES_BINARY ? cv::NORM_HAMMING : cv::NORM_L2;
+}
+
+bool FeaturePipeline::sharesScaleSpace() const
+{
+    return sharesScaleSpace(cfg);
+}
+
+bool FeaturePipeline::sharesScaleSpace(const PipelineConfig &config)
+{
+    if (config.detectionScale > 1)
+        return false;
+
+    // the detector and extractor objects are created with the same (default) parameters
+    switch (config.detectorType)
+    {
+    case DetectorType::BRISK: return config.descriptorType == DescriptorType::BRISK;
+    case DetectorType::ORB: return config.descriptorType == DescriptorType::ORB;
+    case DetectorType::AKAZE: return config.descriptorType == DescriptorType::AKAZE;
+    case DetectorType::SIFT: return config.descriptorType == DescriptorType::SIFT;
+    default: return false;
+    }
+}
+
+double FeaturePipeline::detectAndDescribe(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, cv::Mat &descriptors)
+{
+    TRACE_SCOPE("detect and describe");
+    CV_Assert(sharesScaleSpace());
+    double t = (double)cv::getTickCount();
+    detector->detectAndCompute(img, cv::noArray(), keypoints, descriptors);
+    quantize(descriptors);
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
+
+double FeaturePipeline::detectAndDescribe(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois, cv::Mat &descriptors)
+{
+    TRACE_SCOPE("detect and describe ROI");
+    CV_Assert(sharesScaleSpace());
+    double t = (double)cv::getTickCount();
+
+    // the descriptor pattern of keypoints close to the window edge may be cut off by the view, the detection
+    // border (32 px) already keeps this to the largest scales
+    int border = detectionBorder();
+    descriptors.release();
+    for (size_t k = 0; k < rois.size(); k++)
+    {
+        cv::Rect window = expandRoi(rois[k] & cv::Rect(cv::Point(0, 0), img.size()), border, img.size());
+        if (window.area() == 0)
+            continue;
+
+        roiKeypoints.clear();
+        roiDescriptors.release();
+        detector->detectAndCompute(img(window), cv::noArray(), roiKeypoints, roiDescriptors);
+
+        // back to full image coordinates, compact the keypoints and descriptor rows this rectangle owns
+        int kept = 0;
+        for (size_t i = 0; i < roiKeypoints.size(); i++)
+        {
+            cv::KeyPoint kpt = roiKeypoints[i];
+            kpt.pt += cv::Point2f((float)window.x, (float)window.y);
+            if (owningRoi(rois, kpt.pt) != (int)k)
+                continue;
+
+            keypoints.push_back(kpt);
+            if (kept != (int)i)
+            {
+                cv::Mat descRow = roiDescriptors.row(kept);
+                roiDescriptors.row((int)i).copyTo(descRow);
+            }
+            kept++;
+        }
+        if (kept > 0)
+            descriptors.push_back(roiDescriptors.rowRange(0, kept));
+    }
+
+    quantize(descriptors);
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
+
+int FeaturePipeline::descriptionBorder(const std::vector<cv::KeyPoint> &keypoints) const
+{
+    float maxSize = 0.0f;
+    for (auto it = keypoints.begin(); it != keypoints.end(); ++it)
+        maxSize = max(maxSize, (*it).size);
+
+    // fixed part and approx. sampling pattern radius in units of the keypoint size
+    int border = 8;
+    float sizeFactor = 1.0f;
+    switch (cfg.descriptorType)
+    {
+    case DescriptorType::BRIEF:
+        border = 28; // 48x48 patch, 9x9 smoothing kernel, independent of the keypoint size
+        sizeFactor = 0.0f;
+        break;
+    case DescriptorType::ORB:
+        border = 32; // edge threshold 31, keypoint size 31 * octave scale
+        break;
+    case DescriptorType::AKAZE:
+        sizeFactor = 5.0f; // MLDB grid of +-10 samples at half the keypoint size
+        break;
+    case DescriptorType::SIFT:
+        sizeFactor = 5.5f; // 4x4 histograms of 3 sigma width, rotated
+        break;
+    default: // BRISK, FREAK
+        break;
+    }
+    return border + (int)ceil(sizeFactor * maxSize);
+}
+
+
+// #### Descriptor matching ####
+
+// Find best matches for keypoints in two camera images based on several matching methods
+double FeaturePipeline::match(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<cv::DMatch> &matches)
+{
+    TRACE_SCOPE("match");
+    double t = (double)cv::getTickCount();
+
+    if (cfg.matcherType == MatcherType::MAT_SIMD && cfg.descriptorFamily == DescriptorFamily::DES_HOG)
+    { // integer squared L2 brute force on quantized descriptors, ratio test fused into the search
+        if (cfg.selectorType == SelectorType::SEL_NN)
+            matchL2NN(descSource, descRef, matches);
+        else
+            matchL2KnnRatio(descSource, descRef, matches, cfg.minDescDistRatio);
+
+        t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+        return t;
+    }
+
+    if (cfg.matcherType == MatcherType::MAT_SIMD)
+    { // Hamming brute force with the ratio test fused into the search
+        if (cfg.selectorType == SelectorType::SEL_NN)
+            matchHammingNN(descSource, descRef, matches);
+        else
+            matchHammingKnnRatio(descSource, descRef, matches, cfg.minDescDistRatio);
+
+        t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+        return t;
+    }
+
+    if (cfg.matcherType == MatcherType::MAT_FLANN && cfg.descriptorFamily == DescriptorFamily::DES_BINARY)
+    { // approximate Hamming search directly on the packed descriptors, the index is rebuilt in place for every call
+        lshIndex.build(descRef);
+        if (cfg.selectorType == SelectorType::SEL_NN)
+            lshIndex.matchNN(descSource, matches);
+        else
+            lshIndex.matchKnnRatio(descSource, matches, cfg.minDescDistRatio);
+
+        t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+        return t;
+    }
+
+    // FLANN's k-d tree only takes float descriptors, quantized ones are widened again
+    cv::Mat source = descSource, ref = descRef;
+    if (cfg.matcherType == MatcherType::MAT_FLANN && descSource.depth() == CV_8U)
+    {
+        descSource.convertTo(flannSource, CV_32F);
+        descRef.convertTo(flannRef, CV_32F);
+        source = flannSource;
+        ref = flannRef;
+    }
+
+    // ### perform matching
+    if (cfg.selectorType == SelectorType::SEL_NN) // nearest neighbor (best match)
+    {
+        matcher->match(source, ref, matches); // Finds the best match for each descriptor in desc1
+    }
+
+    else // SEL_KNN, k nearest neighbors (k = 2)
+    {
+        matcher->knnMatch(source, ref, knnMatches, 2); // finds the 2 best matches
+
+        // ### filter matches using descriptor distance ratio test
+        for (auto it = knnMatches.begin(); it != knnMatches.end(); ++it)
+            if ((*it).size() > 1 && (*it)[0].distance < cfg.minDescDistRatio * (*it)[1].distance)
+                matches.push_back((*it)[0]);
+    }
+
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
+
+double FeaturePipeline::match(const DataFrame &frameSource, DataFrame &frameRef, std::vector<cv::DMatch> &matches)
+{
+    if (cfg.matcherType == MatcherType::MAT_GUIDED)
+    {
+        TRACE_SCOPE("match guided");
+        double t = (double)cv::getTickCount();
+
+        // the first match of a sequence has no motion estimate and searches a larger window
+        bool bPredicted = !frameSource.kptMotion.empty() && frameSource.kptMotion.size() == frameSource.keypoints.size();
+        float radius = bPredicted ? cfg.guidedSearchRadius : cfg.guidedInitialRadius;
+        double ratio = cfg.selectorType == SelectorType::SEL_KNN ? cfg.minDescDistRatio : 0.0;
+
+        guidedMatcher.match(frameSource.keypoints, frameSource.descriptors, frameSource.kptMotion,
+                            frameRef.keypoints, frameRef.descriptors, radius, ratio, matches, normType());
+
+        // constant velocity, the motion of this match predicts the next one
+        estimateKeypointMotion(frameSource.keypoints, frameRef.keypoints, matches, frameRef.kptMotion);
+
+        t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+        return t;
+    }
+
+    return match(frameSource.descriptors, frameRef.descriptors, matches);
+}
@@ -0,0 +1,164 @@
+#ifndef featurePipeline_hpp
+#define featurePipeline_hpp
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "dataStructures.h"
+#include "harrisFused.hpp"
+#include "guidedMatching.hpp"
+#include "hammingIndex.hpp"
+
+
+enum class DetectorType { SHITOMASI, HARRIS, HARRIS_FUSED, FAST, BRISK, ORB, AKAZE, SIFT }; // HARRIS_FUSED: same corners as HARRIS, fused kernel
+enum class DescriptorType { BRISK, BRIEF, ORB, FREAK, AKAZE, SIFT };
+enum class DescriptorFamily { DES_BINARY, DES_HOG };    // binary based (BRIEF, BRISK, ORB, FREAK, AKAZE) or gradient based (SIFT)
+enum class MatcherType { MAT_BF, MAT_FLANN, MAT_SIMD, MAT_GUIDED }; // brute force, approximate (FLANN k-d tree / Hamming LSH), native SIMD brute force (binary or quantized)
+                                                                    // or motion-guided windowed search (frame matching only, descriptor only matching uses brute force)
+enum class SelectorType { SEL_NN, SEL_KNN };            // nearest neighbor or k nearest neighbors (k = 2) with ratio test
+
+// string conversion, unknown names throw std::invalid_argument
+DetectorType detectorTypeFromString(const std::string &name);
+DescriptorType descriptorTypeFromString(const std::string &name);
+DescriptorFamily descriptorFamilyFromString(const std::string &name);
+MatcherType matcherTypeFromString(const std::string &name);
+SelectorType selectorTypeFromString(const std::string &name);
+
+std::string toString(DetectorType type);
+std::string toString(DescriptorType type);
+std::string toString(DescriptorFamily family);
+std::string toString(MatcherType type);
+std::string toString(SelectorType type);
+
+DescriptorFamily descriptorFamilyOf(DescriptorType type);
+
+struct PipelineConfig {
+
+    DetectorType detectorType = DetectorType::SHITOMASI;
+    DescriptorType descriptorType = DescriptorType::BRISK;
+    DescriptorFamily descriptorFamily = DescriptorFamily::DES_BINARY;
+    MatcherType matcherType = MatcherType::MAT_BF;
+    SelectorType selectorType = SelectorType::SEL_KNN;
+
+    double minDescDistRatio = 0.8; // descriptor distance ratio used by SEL_KNN
+
+    float guidedSearchRadius = 24.0f;  // [px] MAT_GUIDED window around the position predicted from the last match
+    float guidedInitialRadius = 80.0f; // [px] MAT_GUIDED window if the source frame has no motion estimate
+
+    int detectionScale = 1; // 1, 2 or 4: detect on the image downsampled by this factor, keypoints are mapped back
+    bool bSubPixel = false; // refine corner positions at full resolution, always on if detectionScale > 1
+
+    bool bQuantizeDescriptors = false; // DES_HOG: store descriptors as CV_8U, MAT_SIMD then matches with integer L2
+};
+
+// Detector, descriptor extractor and matcher for one configuration.
+// All OpenCV objects are created once in the constructor, the detect/describe/match calls do no setup work.
+// An instance is not thread safe, use one pipeline per thread.
+class FeaturePipeline
+{
+public:
+    explicit FeaturePipeline(const PipelineConfig &config);
+
+    const PipelineConfig &config() const { return cfg; }
+
+    // cv::NormTypes the descriptors are compared with, NORM_HAMMING for binary descriptors, NORM_L2 otherwise
+    int normType() const;
+
+    // Detector threshold in the detector's own unit (see detectorThresholdRange), higher values give fewer keypoints.
+    // Starts at the default, values outside the useful range are clamped.
+    double detectorThreshold() const { return detThreshold; }
+    void setDetectorThreshold(double threshold);
+    void detectorThresholdRange(double &defaultThreshold, double &minThreshold, double &maxThreshold) const;
+
+    // all functions return the processing time in ms
+    double detect(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, bool bVis = false);
+    double describe(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, cv::Mat &descriptors);
+    double match(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<cv::DMatch> &matches);
+
+    // ROI restricted versions, the work scales with the rectangle area instead of the image size.
+    // Only the rectangles plus the border the detector/descriptor needs are processed, keypoint coordinates refer
+    // to the full image. A keypoint belongs to the first rectangle containing it, keypoints outside all rectangles
+    // are dropped.
+    double detect(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois, bool bVis = false);
+    double describe(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois, cv::Mat &descriptors);
+
+    // Detector and descriptor of the same type (BRISK, ORB, AKAZE, SIFT) are one OpenCV object, so detection and
+    // description can share the image pyramid / nonlinear scale space instead of building it twice per frame.
+    // Never with detectionScale > 1, the detector then sees the downsampled and the extractor the full image.
+    bool sharesScaleSpace() const;
+    static bool sharesScaleSpace(const PipelineConfig &config);
+
+    // detection and description in one pass, only for sharesScaleSpace(). The ROI version runs on each rectangle
+    // grown by the detection border and keeps the keypoints and descriptor rows the rectangle owns.
+    double detectAndDescribe(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, cv::Mat &descriptors);
+    double detectAndDescribe(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois, cv::Mat &descriptors);
+
+    // SHITOMASI, HARRIS and HARRIS_FUSED threshold relative to the response range of the image, so detecting parts
+    // of an image separately gives other corners than one detection over the whole area
+    bool usesRelativeThreshold() const;
+
+    // Response range of the ROI detection of roi (rectangle plus detection border), false if there is no response.
+    // The response is kept and reused by the next ROI detection of the same rectangle.
+    bool measureResponseRange(const cv::Mat &img, const cv::Rect &roi, double &minResponse, double &maxResponse);
+
+    // relative thresholds refer to this range instead of the range of each image until clearResponseRange()
+    void setResponseRange(double minResponse, double maxResponse);
+    void clearResponseRange();
+
+    // same as above, MAT_GUIDED also uses the keypoint positions and stores the keypoint motion in the reference frame,
+    // which predicts the positions for its next match
+    double match(const DataFrame &frameSource, DataFrame &frameRef, std::vector<cv::DMatch> &matches);
+
+private:
+    void createDetector();
+    double detectInImage(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img);
+    double detectNative(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img);
+    void refineCorners(std::vector<cv::KeyPoint> &keypoints, size_t first, const cv::Mat &img);
+    bool refinesCorners() const;
+    void quantize(cv::Mat &descriptors) const;
+    double detectShiTomasi(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img);
+    double detectHarris(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img);
+    double detectHarrisFused(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img);
+    void selectShiTomasiCorners(double minEigenVal, double minDistance, int maxCorners);
+    void updateResponseRange(double minResponse, double maxResponse);
+    void visualizeKeypoints(const std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois);
+
+    int detectionBorder() const;                                          // [px] around a ROI read by the detector
+    int descriptionBorder(const std::vector<cv::KeyPoint> &keypoints) const; // [px] around a ROI read by the extractor
+
+    PipelineConfig cfg;
+    double detThreshold;
+
+    // response range shared with other detections (see setResponseRange)
+    bool bMeasureResponse = false; // detection only measures the response range
+    bool bResponseReady = false;   // the response buffer holds the measured response
+    bool bFixedRange = false;
+    double responseMin = 0.0, responseMax = 0.0;
+    double measuredMin = 0.0, measuredMax = 0.0;
+
+    cv::Ptr<cv::FeatureDetector> detector;        // empty for SHITOMASI, HARRIS and HARRIS_FUSED
+    cv::Ptr<cv::DescriptorExtractor> extractor;   // same object as detector if sharesScaleSpace()
+    cv::Ptr<cv::DescriptorMatcher> matcher;       // empty for MAT_SIMD and binary MAT_FLANN (Hamming LSH)
+
+    // scratch buffers, reused between calls
+    std::vector<cv::Point2f> corners;
+    cv::Mat harrisResponse, harrisResponseNorm;
+    cv::Mat shiTomasiResponse, shiTomasiThresholded, shiTomasiDilated;
+    std::vector<std::pair<float, int>> shiTomasiCandidates; // response, pixel index
+    FusedHarris fusedHarris;
+    std::vector<std::vector<cv::DMatch>> knnMatches;
+    cv::Mat flannSource, flannRef; // float copies of quantized descriptors
+    GuidedMatcher guidedMatcher;
+    HammingLshIndex lshIndex; // binary MAT_FLANN, rebuilt for every reference
+    std::vector<cv::KeyPoint> roiKeypoints, describedKeypoints;
+    cv::Mat roiDescriptors;
+    std::vector<cv::Mat> roiDescriptorParts; // describe() with rectangles, one block of rows per rectangle
+    cv::Mat coarseImg;
+    std::vector<cv::KeyPoint> coarseKeypoints;
+    std::vector<cv::Point2f> subPixCorners;
+};
+
+#endif /* featurePipeline_hpp */
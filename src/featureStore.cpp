@@ -0,0 +1,370 @@
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "featureStore.hpp"
+#include "tracing.hpp"
+
+using namespace std;
+
+// file layout: file header, records (header + column blocks, 64 byte aligned), optional index and trailer
+static const char storeMagic[8] = {'F', 'E', 'A', 'T', 'S', 'T', 'O', 'R'};
+static const char recordMagic[4] = {'F', 'R', 'E', 'C'};
+static const char indexMagic[4] = {'F', 'I', 'D', 'X'};
+static const uint32_t storeVersion = 2;
+static const uint64_t storeAlignment = 64;
+
+enum StoreBlock { BLOCK_X, BLOCK_Y, BLOCK_SIZE, BLOCK_ANGLE, BLOCK_RESPONSE, BLOCK_OCTAVE, BLOCK_CLASS_ID,
+                  BLOCK_DESCRIPTORS, BLOCK_QUERY_IDX, BLOCK_TRAIN_IDX, BLOCK_DISTANCE, BLOCK_COUNT };
+
+struct StoreHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t normType; // cv::NormTypes the descriptors are matched with
+};
+
+struct RecordHeader {
+    char magic[4];
+    uint32_t frameIndex;
+    uint32_t keypointCount;
+    uint32_t matchCount;
+    int32_t descRows;
+    int32_t descCols;
+    int32_t descType;
+    uint32_t reserved;
+    uint64_t recordSize;                // bytes from the start of the record to the next record
+    uint64_t blockOffset[BLOCK_COUNT]; // relative to the start of the record
+};
+
+struct IndexEntry {
+    uint64_t offset; // of the record from the start of the file
+    uint32_t frameIndex;
+    uint32_t reserved;
+};
+
+struct IndexTrailer { // last bytes of a closed file
+    char magic[4];
+    uint32_t count;
+    uint64_t indexOffset;
+};
+
+static uint64_t alignUp(uint64_t offset)
+{
+    return (offset + storeAlignment - 1) / storeAlignment * storeAlignment;
+}
+
+
+// #### Frame view ####
+
+void FeatureFrameView::copyKeypoints(std::vector<cv::KeyPoint> &keypoints) const
+{
+    keypoints.resize(keypointCount());
+    for (size_t i = 0; i < keypoints.size(); i++)
+        keypoints[i] = cv::KeyPoint(x[i], y[i], size[i], angle[i], response[i], octave[i], classId[i]);
+}
+
+void FeatureFrameView::copyMatches(std::vector<cv::DMatch> &matches) const
+{
+    matches.resize(matchCount());
+    for (size_t i = 0; i < matches.size(); i++)
+        matches[i] = cv::DMatch(queryIdx[i], trainIdx[i], distance[i]);
+}
+
+
+// #### Writer ####
+
+FeatureStoreWriter::FeatureStoreWriter(const std::string &filename, int normType)
+    : filename(filename), out(filename, ios::out | ios::binary | ios::trunc), position(0)
+{
+    if (!out)
+        throw runtime_error("could not create feature store " + filename);
+
+    StoreHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, storeMagic, sizeof(storeMagic));
+    header.version = storeVersion;
+    header.normType = normType;
+    writeBlock(&header, sizeof(header));
+}
+
+FeatureStoreWriter::~FeatureStoreWriter()
+{
+    close();
+}
+
+void FeatureStoreWriter::writeBlock(const void *data, uint64_t bytes)
+{
+    out.write(static_cast<const char *>(data), bytes);
+    position += bytes;
+}
+
+void FeatureStoreWriter::align()
+{
+    static const char padding[storeAlignment] = {0};
+    writeBlock(padding, alignUp(position) - position);
+}
+
+void FeatureStoreWriter::append(uint32_t frameIndex, const DataFrame &frame)
+{
+    TRACE_SCOPE("append features");
+    if (!out.is_open())
+        throw runtime_error("feature store " + filename + " is closed");
+
+    columns.assign(frame.keypoints);
+    queryColumn.clear();
+    trainColumn.clear();
+    distanceColumn.clear();
+    for (auto it = frame.kptMatches.begin(); it != frame.kptMatches.end(); ++it)
+    {
+        queryColumn.push_back((*it).queryIdx);
+        trainColumn.push_back((*it).trainIdx);
+        distanceColumn.push_back((*it).distance);
+    }
+
+    const cv::Mat &desc = frame.descriptors;
+    uint64_t rowBytes = (uint64_t)desc.cols * desc.elemSize();
+    uint64_t kptCount = columns.size(), matchCount = queryColumn.size();
+    uint64_t blockBytes[BLOCK_COUNT] = {
+        kptCount * sizeof(float), kptCount * sizeof(float), kptCount * sizeof(float), kptCount * sizeof(float),
+        kptCount * sizeof(float), kptCount * sizeof(int32_t), kptCount * sizeof(int32_t),
+        (uint64_t)desc.rows * rowBytes,
+        matchCount * sizeof(int32_t), matchCount * sizeof(int32_t), matchCount * sizeof(float)};
+    const void *blockData[BLOCK_COUNT] = {
+        columns.x.data(), columns.y.data(), columns.kptSize.data(), columns.angle.data(), columns.response.data(),
+        columns.octave.data(), columns.classId.data(), nullptr,
+        queryColumn.data(), trainColumn.data(), distanceColumn.data()};
+
+    // every block starts on an aligned offset, the sizes are known up front, so the header is written first
+    align();
+    uint64_t recordStart = position;
+    RecordHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, recordMagic, sizeof(recordMagic));
+    header.frameIndex = frameIndex;
+    header.keypointCount = (uint32_t)kptCount;
+    header.matchCount = (uint32_t)matchCount;
+    header.descRows = desc.rows;
+    header.descCols = desc.cols;
+    header.descType = desc.type();
+    uint64_t offset = sizeof(RecordHeader);
+    for (int b = 0; b < BLOCK_COUNT; b++)
+    {
+        offset = alignUp(offset);
+        header.blockOffset[b] = offset;
+        offset += blockBytes[b];
+    }
+    header.recordSize = alignUp(offset);
+    writeBlock(&header, sizeof(header));
+
+    for (int b = 0; b < BLOCK_COUNT; b++)
+    {
+        align();
+        if (b == BLOCK_DESCRIPTORS)
+        {
+            for (int r = 0; r < desc.rows; r++)
+                writeBlock(desc.ptr(r), rowBytes);
+        }
+        else
+            writeBlock(blockData[b], blockBytes[b]);
+    }
+    align();
+
+    if (!out)
+        throw runtime_error("could not write feature store " + filename);
+    recordOffsets.push_back(recordStart);
+    recordFrames.push_back(frameIndex);
+}
+
+void FeatureStoreWriter::close()
+{
+    if (!out.is_open())
+        return;
+
+    vector<IndexEntry> entries(recordOffsets.size());
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        memset(&entries[i], 0, sizeof(IndexEntry));
+        entries[i].offset = recordOffsets[i];
+        entries[i].frameIndex = recordFrames[i];
+    }
+
+    IndexTrailer trailer;
+    memcpy(trailer.magic, indexMagic, sizeof(indexMagic));
+    trailer.count = (uint32_t)entries.size();
+    trailer.indexOffset = position;
+    writeBlock(entries.data(), entries.size() * sizeof(IndexEntry));
+    writeBlock(&trailer, sizeof(trailer));
+    out.close();
+}
+
+
+// #### Reader ####
+
+FeatureStoreReader::FeatureStoreReader() : mappedData(nullptr), mappedSize(0), descNormType(cv::NORM_L2)
+{
+}
+
+FeatureStoreReader::~FeatureStoreReader()
+{
+    close();
+}
+
+void FeatureStoreReader::close()
+{
+    records.clear();
+    if (mappedData)
+    {
+        munmap(mappedData, mappedSize);
+        mappedData = nullptr;
+        mappedSize = 0;
+    }
+}
+
+template <typename T>
+static ArrayView<T> blockView(const uint8_t *record, const RecordHeader &header, int block, size_t count)
+{
+    ArrayView<T> view;
+    view.data = reinterpret_cast<const T *>(record + header.blockOffset[block]);
+    view.size = count;
+    return view;
+}
+
+bool FeatureStoreReader::parseRecord(uint64_t offset, FeatureFrameView &view, uint64_t &recordEnd) const
+{
+    // no complete record at the offset: end of the records, or a partially written last record
+    const uint8_t *base = static_cast<const uint8_t *>(mappedData);
+    if (offset % storeAlignment != 0 || offset > mappedSize || sizeof(RecordHeader) > mappedSize - offset)
+        return false;
+    const RecordHeader &header = *reinterpret_cast<const RecordHeader *>(base + offset);
+    if (memcmp(header.magic, recordMagic, sizeof(recordMagic)) != 0 || header.recordSize > mappedSize - offset)
+        return false;
+
+    // a complete record with an inconsistent header is corrupt
+    string position = " (record at offset " + to_string(offset) + ")";
+    if (header.recordSize < sizeof(RecordHeader) || header.recordSize % storeAlignment != 0)
+        throw runtime_error("invalid record size in feature store" + position);
+    if (header.descType < 0 || CV_MAT_TYPE(header.descType) != header.descType || header.descRows < 0 || header.descCols < 0
+        || (header.descRows > 0 && (uint32_t)header.descRows != header.keypointCount))
+        throw runtime_error("invalid descriptor shape in feature store" + position);
+
+    // every block has to lie inside the record, the sizes fit into 64 bit because the counts are 32 bit
+    uint64_t kpts = header.keypointCount, matches = header.matchCount;
+    uint64_t descRowBytes = (uint64_t)header.descCols * CV_ELEM_SIZE(header.descType);
+    if (descRowBytes > 0 && (uint64_t)header.descRows > header.recordSize / descRowBytes)
+        throw runtime_error("descriptors exceed their record in feature store" + position);
+    uint64_t blockBytes[BLOCK_COUNT] = {kpts * sizeof(float), kpts * sizeof(float), kpts * sizeof(float), kpts * sizeof(float),
+                                        kpts * sizeof(float), kpts * sizeof(int32_t), kpts * sizeof(int32_t),
+                                        (uint64_t)header.descRows * descRowBytes,
+                                        matches * sizeof(int32_t), matches * sizeof(int32_t), matches * sizeof(float)};
+    for (int b = 0; b < BLOCK_COUNT; b++)
+    {
+        uint64_t blockOffset = header.blockOffset[b];
+        if (blockOffset % storeAlignment != 0 || blockOffset < sizeof(RecordHeader) || blockOffset > header.recordSize
+            || blockBytes[b] > header.recordSize - blockOffset)
+            throw runtime_error("block outside its record in feature store" + position);
+    }
+
+    const uint8_t *record = base + offset;
+    view.frameIndex = header.frameIndex;
+    view.x = blockView<float>(record, header, BLOCK_X, kpts);
+    view.y = blockView<float>(record, header, BLOCK_Y, kpts);
+    view.size = blockView<float>(record, header, BLOCK_SIZE, kpts);
+    view.angle = blockView<float>(record, header, BLOCK_ANGLE, kpts);
+    view.response = blockView<float>(record, header, BLOCK_RESPONSE, kpts);
+    view.octave = blockView<int32_t>(record, header, BLOCK_OCTAVE, kpts);
+    view.classId = blockView<int32_t>(record, header, BLOCK_CLASS_ID, kpts);
+    view.queryIdx = blockView<int32_t>(record, header, BLOCK_QUERY_IDX, matches);
+    view.trainIdx = blockView<int32_t>(record, header, BLOCK_TRAIN_IDX, matches);
+    view.distance = blockView<float>(record, header, BLOCK_DISTANCE, matches);
+
+    // header onto the mapped rows, no copy (read-only mapping)
+    view.descriptors = cv::Mat(header.descRows, header.descCols, header.descType,
+                               const_cast<uint8_t *>(record + header.blockOffset[BLOCK_DESCRIPTORS]));
+
+    recordEnd = offset + header.recordSize;
+    return true;
+}
+
+void FeatureStoreReader::open(const std::string &filename)
+{
+    TRACE_SCOPE("map feature store");
+    close();
+
+    struct stat fileStat;
+    if (stat(filename.c_str(), &fileStat) != 0)
+        throw runtime_error("could not open feature store " + filename);
+    size_t fileSize = (size_t)fileStat.st_size;
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw runtime_error("could not open feature store " + filename);
+    void *data = fileSize > 0 ? mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd); // the mapping stays valid
+    if (data == MAP_FAILED)
+        throw runtime_error("could not map feature store " + filename);
+    mappedData = data;
+    mappedSize = fileSize;
+
+    const uint8_t *base = static_cast<const uint8_t *>(data);
+    const StoreHeader *header = reinterpret_cast<const StoreHeader *>(base);
+    if (fileSize < sizeof(StoreHeader) || memcmp(header->magic, storeMagic, sizeof(storeMagic)) != 0
+        || header->version != storeVersion)
+    {
+        close();
+        throw runtime_error(filename + " is not a feature store (version " + to_string(storeVersion) + ")");
+    }
+    descNormType = header->normType;
+
+    try
+    {
+        readRecords();
+    }
+    catch (...)
+    {
+        close();
+        throw;
+    }
+}
+
+void FeatureStoreReader::readRecords()
+{
+    const uint8_t *base = static_cast<const uint8_t *>(mappedData);
+    size_t fileSize = mappedSize;
+
+    // closed file: records from the index
+    bool bIndexed = false;
+    if (fileSize >= sizeof(StoreHeader) + sizeof(IndexTrailer))
+    {
+        const IndexTrailer &trailer = *reinterpret_cast<const IndexTrailer *>(base + fileSize - sizeof(IndexTrailer));
+        uint64_t indexBytes = (uint64_t)trailer.count * sizeof(IndexEntry), indexSpace = fileSize - sizeof(IndexTrailer);
+        if (memcmp(trailer.magic, indexMagic, sizeof(indexMagic)) == 0 && trailer.indexOffset <= indexSpace
+            && indexBytes == indexSpace - trailer.indexOffset)
+        {
+            const IndexEntry *entries = reinterpret_cast<const IndexEntry *>(base + trailer.indexOffset);
+            records.resize(trailer.count);
+            bIndexed = true;
+            for (uint32_t i = 0; bIndexed && i < trailer.count; i++)
+            {
+                uint64_t recordEnd;
+                bIndexed = parseRecord(entries[i].offset, records[i], recordEnd);
+            }
+        }
+    }
+
+    // unfinished file: walk the records, a partially written last record is ignored
+    if (!bIndexed)
+    {
+        records.clear();
+        uint64_t offset = alignUp(sizeof(StoreHeader));
+        FeatureFrameView view;
+        uint64_t recordEnd;
+        while (parseRecord(offset, view, recordEnd))
+        {
+            records.push_back(view);
+            offset = recordEnd;
+        }
+    }
+}
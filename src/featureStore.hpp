@@ -0,0 +1,120 @@
+#ifndef featureStore_hpp
+#define featureStore_hpp
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "keypointStore.hpp"
+
+
+// Binary feature store: keypoints, descriptors and matches of a frame sequence
+// The file is an append-only stream of frame records after a short file header. Every record holds 64 byte aligned
+// column blocks: the keypoint fields as separate arrays (x, y, size, angle, response, octave, class id), the packed
+// descriptor rows and the matches as query index, train index and distance arrays. Closing the writer appends an
+// index of the record offsets; a file without index (writer did not finish) is still readable, the reader then
+// walks the records from the start. The reader maps the file and hands out views onto the blocks without copying.
+// Format version 2, little endian, matches refer to the previous record like DataFrame::kptMatches. The file header
+// holds the norm the descriptors are matched with, so readers need not guess it from the descriptor shape.
+
+// read-only view onto a mapped array
+template <typename T>
+struct ArrayView
+{
+    const T *data = nullptr;
+    size_t size = 0;
+
+    const T &operator[](size_t i) const { return data[i]; }
+    const T *begin() const { return data; }
+    const T *end() const { return data + size; }
+};
+
+struct FeatureFrameView { // one record of a mapped feature store
+
+    uint32_t frameIndex = 0;
+
+    ArrayView<float> x, y, size, angle, response;
+    ArrayView<int32_t> octave, classId;
+
+    cv::Mat descriptors; // header onto the mapped rows, read-only
+
+    // matches against the previous record: queryIdx indexes the keypoints of the previous record, trainIdx the
+    // keypoints (and descriptor rows) of this record
+    ArrayView<int32_t> queryIdx, trainIdx;
+    ArrayView<float> distance;
+
+    size_t keypointCount() const { return x.size; }
+    size_t matchCount() const { return queryIdx.size; }
+
+    // copies in the OpenCV types
+    void copyKeypoints(std::vector<cv::KeyPoint> &keypoints) const;
+    void copyMatches(std::vector<cv::DMatch> &matches) const;
+};
+
+class FeatureStoreWriter
+{
+public:
+    // creates or truncates the file, throws std::runtime_error if it can not be opened
+    // normType is the cv::NormTypes of the descriptors (FeaturePipeline::normType)
+    FeatureStoreWriter(const std::string &filename, int normType);
+    ~FeatureStoreWriter();
+
+    FeatureStoreWriter(const FeatureStoreWriter &) = delete;
+    FeatureStoreWriter &operator=(const FeatureStoreWriter &) = delete;
+
+    // keypoints, descriptors and kptMatches of the frame
+    void append(uint32_t frameIndex, const DataFrame &frame);
+
+    // writes the index, called by the destructor if necessary
+    void close();
+
+private:
+    void writeBlock(const void *data, uint64_t bytes);
+    void align();
+
+    std::string filename;
+    std::ofstream out;
+    uint64_t position; // bytes written so far
+
+    std::vector<uint64_t> recordOffsets;
+    std::vector<uint32_t> recordFrames;
+    KeypointStore columns; // keypoints as column arrays
+    std::vector<int32_t> queryColumn, trainColumn;
+    std::vector<float> distanceColumn;
+};
+
+class FeatureStoreReader
+{
+public:
+    FeatureStoreReader();
+    ~FeatureStoreReader();
+
+    FeatureStoreReader(const FeatureStoreReader &) = delete;
+    FeatureStoreReader &operator=(const FeatureStoreReader &) = delete;
+
+    // maps the file, throws std::runtime_error if it is missing, not a feature store or holds a corrupt record
+    void open(const std::string &filename);
+    void close();
+
+    size_t size() const { return records.size(); }
+    const FeatureFrameView &frame(size_t record) const { return records[record]; }
+
+    int normType() const { return descNormType; } // cv::NormTypes given to the writer
+
+private:
+    // records from the index, or walked from the start of an unfinished file
+    void readRecords();
+    // false if there is no complete record at the offset, throws std::runtime_error if the record is corrupt
+    bool parseRecord(uint64_t offset, FeatureFrameView &view, uint64_t &recordEnd) const;
+
+    void *mappedData; // views point into the mapping
+    size_t mappedSize;
+    int descNormType;
+    std::vector<FeatureFrameView> records;
+};
+
+#endif /* featureStore_hpp */
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "frameSource.hpp"
+#include "tracing.hpp"
+
+using namespace std;
+
+// every frame is written to a new Mat, the caller may still hold the previous one
+static cv::Mat toGray(const cv::Mat &img)
+{
+    cv::Mat imgGray;
+    if (img.channels() == 1)
+        img.copyTo(imgGray);
+    else
+        cv::cvtColor(img, imgGray, cv::COLOR_BGR2GRAY);
+    return imgGray;
+}
+
+static bool isDirectory(const string &path)
+{
+    struct stat pathStat;
+    return stat(path.c_str(), &pathStat) == 0 && S_ISDIR(pathStat.st_mode);
+}
+
+static bool isFile(const string &path)
+{
+    struct stat pathStat;
+    return stat(path.c_str(), &pathStat) == 0 && S_ISREG(pathStat.st_mode);
+}
+
+ImageListSource::ImageListSource(const std::vector<std::string> &filenames) : filenames(filenames), next(0)
+{
+}
+
+bool ImageListSource::read(cv::Mat &img)
+{
+    if (next >= filenames.size())
+        return false;
+
+    TRACE_SCOPE("decode frame");
+    const string &filename = filenames[next++];
+    cv::Mat decoded = cv::imread(filename);
+    if (decoded.empty())
+        throw runtime_error("could not read image " + filename);
+    img = toGray(decoded);
+    return true;
+}
+
+std::vector<std::string> ImageListSource::globFiles(const std::string &pattern)
+{
+    vector<cv::String> matches;
+    cv::glob(pattern, matches, false);
+
+    vector<string> filenames(matches.begin(), matches.end());
+    sort(filenames.begin(), filenames.end());
+    return filenames;
+}
+
+std::vector<std::string> ImageListSource::kittiFiles(const std::string &dir)
+{
+    string dataDir = dir;
+    if (!dataDir.empty() && dataDir[dataDir.size() - 1] != '/')
+        dataDir += "/";
+    if (isDirectory(dataDir + "data"))
+        dataDir += "data/";
+
+    // KITTI raw data names the images by a 10 digit index without gaps
+    vector<string> filenames;
+    for (int imgIndex = 0;; imgIndex++)
+    {
+        ostringstream imgNumber;
+        imgNumber << setfill('0') << setw(10) << imgIndex;
+        string filename = dataDir + imgNumber.str() + ".png";
+        if (!isFile(filename))
+            break;
+        filenames.push_back(filename);
+    }
+    return filenames;
+}
+
+VideoFrameSource::VideoFrameSource(const std::string &filename) : frameCount(0)
+{
+    if (!capture.open(filename))
+        throw runtime_error("could not open video " + filename);
+
+    double count = capture.get(cv::CAP_PROP_FRAME_COUNT);
+    if (count > 0)
+        frameCount = (size_t)count;
+}
+
+bool VideoFrameSource::read(cv::Mat &img)
+{
+    TRACE_SCOPE("decode frame");
+    if (!capture.read(decoded) || decoded.empty())
+        return false;
+    img = toGray(decoded);
+    return true;
+}
+
+RawFrameSource::RawFrameSource(const std::string &filename) : next(0)
+{
+    store.loadRaw(filename);
+}
+
+bool RawFrameSource::read(cv::Mat &img)
+{
+    if (next >= store.size())
+        return false;
+    img = store.frame(next++); // header onto the mapping
+    return true;
+}
+
+PrefetchFrameSource::PrefetchFrameSource(std::unique_ptr<FrameSource> source, size_t depth)
+    : source(move(source)), queue(max<size_t>(1, depth)), bStop(false), bFinished(false), totalWaitTime(0.0)
+{
+    sourceSize = this->source->size();
+    bSourceMapped = this->source->isMapped();
+    reader = thread(&PrefetchFrameSource::readAhead, this);
+}
+
+PrefetchFrameSource::~PrefetchFrameSource()
+{
+    bStop = true;
+    reader.join();
+}
+
+// spin briefly, then yield, then sleep, see StreamPipeline
+static void backoff(int &spins)
+{
+    if (++spins < 64)
+        return;
+    if (spins < 256)
+        this_thread::yield();
+    else
+        this_thread::sleep_for(chrono::microseconds(50));
+}
+
+void PrefetchFrameSource::readAhead()
+{
+    setTraceThreadName("prefetch");
+    while (!bStop)
+    {
+        PrefetchItem item;
+        try
+        {
+            TRACE_SCOPE("prefetch read");
+            item.bEndOfStream = !source->read(item.img);
+        }
+        catch (const exception &e)
+        {
+            item.bEndOfStream = true;
+            item.error = e.what();
+        }
+
+        bool bEndOfStream = item.bEndOfStream;
+        int spins = 0;
+        while (!queue.tryPush(item))
+        {
+            if (bStop)
+                return;
+            backoff(spins);
+        }
+        if (bEndOfStream)
+            return;
+    }
+}
+
+bool PrefetchFrameSource::read(cv::Mat &img)
+{
+    if (bFinished)
+        return false;
+
+    PrefetchItem item;
+    double t = (double)cv::getTickCount();
+    int spins = 0;
+    while (!queue.tryPop(item))
+        backoff(spins);
+    totalWaitTime += (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+
+    if (item.bEndOfStream)
+    {
+        bFinished = true;
+        if (!item.error.empty())
+            throw runtime_error(item.error);
+        return false;
+    }
+    img = item.img;
+    return true;
+}
+
+static bool hasSuffix(const string &str, const string &suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::unique_ptr<FrameSource> openFrameSource(const std::string &spec)
+{
+    string type, location = spec;
+    size_t colon = spec.find(':');
+    if (colon != string::npos)
+    {
+        type = spec.substr(0, colon);
+        location = spec.substr(colon + 1);
+    }
+    if (type != "glob" && type != "kitti" && type != "video" && type != "raw")
+    {
+        // no known prefix (e.g. a stream URL like rtsp://...), derive the type from the whole spec
+        location = spec;
+        if (isDirectory(location))
+            type = "kitti";
+        else if (location.find_first_of("*?") != string::npos)
+            type = "glob";
+        else if (hasSuffix(location, ".gray") || hasSuffix(location, ".raw") || hasSuffix(location, ".cache"))
+            type = "raw";
+        else
+            type = "video";
+    }
+
+    unique_ptr<FrameSource> source;
+    if (type == "glob" || type == "kitti")
+    {
+        vector<string> filenames = type == "glob" ? ImageListSource::globFiles(location) : ImageListSource::kittiFiles(location);
+        if (filenames.empty())
+            throw runtime_error("no images found for " + spec);
+        source.reset(new ImageListSource(filenames));
+    }
+    else if (type == "video")
+        source.reset(new VideoFrameSource(location));
+    else
+        source.reset(new RawFrameSource(location));
+    return source;
+}
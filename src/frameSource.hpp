@@ -0,0 +1,134 @@
+#ifndef frameSource_hpp
+#define frameSource_hpp
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "frameStore.hpp"
+#include "spscQueue.hpp"
+
+
+// Sequential input of 8-bit grayscale frames
+// Sources are read front to back exactly once. Every call of read() hands out a new image, so frames may be kept
+// (or passed to another thread) while the next one is read. Frames of a raw dump point into the source's mapping
+// and stay valid only as long as the source.
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+
+    // next frame, false at the end of the sequence
+    virtual bool read(cv::Mat &img) = 0;
+
+    // number of frames, 0 if not known in advance
+    virtual size_t size() const = 0;
+
+    // frames point into a memory mapping instead of being decoded into RAM
+    virtual bool isMapped() const { return false; }
+};
+
+// image files decoded with cv::imread, in the given order
+class ImageListSource : public FrameSource
+{
+public:
+    explicit ImageListSource(const std::vector<std::string> &filenames);
+
+    bool read(cv::Mat &img) override; // throws std::runtime_error if an image can not be decoded
+    size_t size() const override { return filenames.size(); }
+
+    // files matching a cv::glob pattern (e.g. "data/*.png"), sorted by name
+    static std::vector<std::string> globFiles(const std::string &pattern);
+
+    // KITTI raw sequence: <dir>/0000000000.png, <dir>/0000000001.png, ... up to the first missing index
+    // dir may also be the camera directory (image_00), its data subdirectory is used then
+    static std::vector<std::string> kittiFiles(const std::string &dir);
+
+private:
+    std::vector<std::string> filenames;
+    size_t next;
+};
+
+// video file or camera stream decoded with cv::VideoCapture
+class VideoFrameSource : public FrameSource
+{
+public:
+    explicit VideoFrameSource(const std::string &filename); // throws std::runtime_error if the file can not be opened
+
+    bool read(cv::Mat &img) override;
+    size_t size() const override { return frameCount; } // container estimate, may be 0
+
+private:
+    cv::VideoCapture capture;
+    cv::Mat decoded; // reused by the decoder
+    size_t frameCount;
+};
+
+// raw grayscale dump in the FrameStore cache format (--frame-cache), memory-mapped, frames are not copied
+class RawFrameSource : public FrameSource
+{
+public:
+    explicit RawFrameSource(const std::string &filename); // throws std::runtime_error if the file is not a valid dump
+
+    bool read(cv::Mat &img) override;
+    size_t size() const override { return store.size(); }
+    bool isMapped() const override { return true; }
+
+private:
+    FrameStore store;
+    size_t next;
+};
+
+// Reads ahead on a background thread
+// The wrapped source is read on its own thread into a bounded queue of depth frames, so decoding the next frames
+// overlaps with processing the current one. read() only waits if the queue has run dry.
+class PrefetchFrameSource : public FrameSource
+{
+public:
+    PrefetchFrameSource(std::unique_ptr<FrameSource> source, size_t depth);
+    ~PrefetchFrameSource();
+
+    PrefetchFrameSource(const PrefetchFrameSource &) = delete;
+    PrefetchFrameSource &operator=(const PrefetchFrameSource &) = delete;
+
+    bool read(cv::Mat &img) override; // rethrows errors of the wrapped source
+    size_t size() const override { return sourceSize; }
+    bool isMapped() const override { return bSourceMapped; }
+
+    double waitTime() const { return totalWaitTime; } // [ms] read() blocked on an empty queue
+
+private:
+    struct PrefetchItem {
+        cv::Mat img;
+        bool bEndOfStream = false;
+        std::string error; // message of an exception thrown by the wrapped source
+    };
+
+    void readAhead();
+
+    std::unique_ptr<FrameSource> source;
+    size_t sourceSize;
+    bool bSourceMapped;
+    SpscQueue<PrefetchItem> queue;
+    std::atomic<bool> bStop;
+    bool bFinished; // end of stream was taken from the queue
+    double totalWaitTime;
+    std::thread reader;
+};
+
+// Opens a source from "<type>:<location>", type is one of
+//   glob:<pattern>    image files matching the pattern
+//   kitti:<dir>       KITTI raw image sequence of any length
+//   video:<file>      anything cv::VideoCapture can decode
+//   raw:<file>        raw grayscale dump written with --frame-cache
+// Without a type prefix it is derived from the location: directories are KITTI sequences, patterns with '*' or '?'
+// are globs, .gray/.raw/.cache files are raw dumps, everything else is passed to cv::VideoCapture.
+// Throws std::runtime_error if the input can not be opened.
+std::unique_ptr<FrameSource> openFrameSource(const std::string &spec);
+
+#endif /* frameSource_hpp */
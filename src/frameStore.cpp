@@ -0,0 +1,311 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "frameSource.hpp"
+#include "frameStore.hpp"
+#include "tracing.hpp"
+
+using namespace std;
+
+// raw cache file layout: header, 8-bit grayscale planes (each 64 byte aligned), one table entry per frame at the end
+static const char cacheMagic[8] = {'G', 'R', 'A', 'Y', 'F', 'R', 'M', 'S'};
+static const uint32_t cacheVersion = 3;
+static const uint64_t cacheAlignment = 64;
+
+struct FrameCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t frameCount;
+    uint64_t tableOffset; // byte offset of the frame table from the start of the file
+    uint64_t sourceHash;  // sourceHash() of the images the cache was written from, 0 for raw dumps
+};
+
+struct FrameCacheEntry {
+    int32_t rows;
+    int32_t cols;
+    uint64_t offset; // byte offset of the plane from the start of the file
+};
+
+// Writes a cache file front to back, so every frame can be dropped as soon as it is written. The frame count is only
+// known at the end, the table follows the planes and the header is written last (a partial file has no magic).
+class FrameCacheWriter
+{
+public:
+    explicit FrameCacheWriter(const std::string &file) : out(file, ios::out | ios::binary | ios::trunc)
+    {
+        FrameCacheHeader header = {};
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    bool good() const { return (bool)out; }
+    size_t size() const { return entries.size(); }
+
+    void append(const cv::Mat &img)
+    {
+        CV_Assert(img.type() == CV_8UC1);
+        FrameCacheEntry entry;
+        entry.rows = img.rows;
+        entry.cols = img.cols;
+        entry.offset = pad();
+        entries.push_back(entry);
+        for (int r = 0; r < img.rows; r++)
+            out.write(img.ptr<char>(r), img.cols);
+    }
+
+    bool finish(uint64_t sourceHash = 0)
+    {
+        FrameCacheHeader header;
+        memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+        header.version = cacheVersion;
+        header.frameCount = (uint32_t)entries.size();
+        header.tableOffset = pad();
+        header.sourceHash = sourceHash;
+        out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(FrameCacheEntry));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.close();
+        return (bool)out;
+    }
+
+private:
+    // zero bytes up to the next aligned offset, returns that offset
+    uint64_t pad()
+    {
+        uint64_t offset = (uint64_t)out.tellp();
+        uint64_t aligned = (offset + cacheAlignment - 1) / cacheAlignment * cacheAlignment;
+        const char padding[cacheAlignment] = {0};
+        out.write(padding, aligned - offset);
+        return aligned;
+    }
+
+    std::ofstream out;
+    std::vector<FrameCacheEntry> entries;
+};
+
+// FNV-1a over the path, byte size and modification time of every image, so renamed, replaced, resized or touched
+// images (also ones restored with an older time stamp) invalidate the cache
+static uint64_t sourceHash(const std::vector<std::string> &filenames)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const void *data, size_t size) {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+    };
+
+    for (auto it = filenames.begin(); it != filenames.end(); ++it)
+    {
+        struct stat imgStat;
+        int64_t fileInfo[2] = {-1, -1}; // missing files hash differently from any existing one
+        if (stat((*it).c_str(), &imgStat) == 0)
+        {
+            fileInfo[0] = (int64_t)imgStat.st_size;
+            fileInfo[1] = (int64_t)imgStat.st_mtime;
+        }
+        add((*it).c_str(), (*it).size() + 1); // with the terminator, so the list can not be re-split
+        add(fileInfo, sizeof(fileInfo));
+    }
+    return hash != 0 ? hash : 1; // 0 marks raw dumps
+}
+
+// new empty file in $TMPDIR (or /tmp)
+static string createTemporaryFile()
+{
+    const char *dir = getenv("TMPDIR");
+    string pattern = string(dir && *dir ? dir : "/tmp") + "/framestore-XXXXXX";
+    vector<char> path(pattern.begin(), pattern.end());
+    path.push_back('\0');
+    int fd = mkstemp(path.data());
+    if (fd < 0)
+        throw runtime_error("could not create a temporary frame file " + pattern);
+    close(fd);
+    return string(path.data());
+}
+
+FrameStore::FrameStore() : mappedData(nullptr), mappedSize(0)
+{
+}
+
+FrameStore::~FrameStore()
+{
+    unmap();
+}
+
+void FrameStore::unmap()
+{
+    frames.clear();
+    if (mappedData)
+    {
+        munmap(mappedData, mappedSize);
+        mappedData = nullptr;
+        mappedSize = 0;
+    }
+}
+
+void FrameStore::load(FrameSource &source, size_t maxFrames, size_t memoryBudget)
+{
+    unmap();
+    frames.reserve(maxFrames > 0 ? maxFrames : source.size());
+
+    // beyond the budget all frames go to a temporary file, which is unlinked once it is mapped
+    unique_ptr<FrameCacheWriter> spill;
+    string spillFile;
+    size_t heapBytes = 0;
+    size_t count = 0;
+    while (maxFrames == 0 || count < maxFrames)
+    {
+        cv::Mat img;
+        if (!source.read(img))
+            break;
+        count++;
+        if (spill)
+        {
+            spill->append(img);
+            continue;
+        }
+
+        frames.push_back(img);
+        if (!source.isMapped())
+            heapBytes += img.total() * img.elemSize();
+        if (memoryBudget > 0 && heapBytes > memoryBudget)
+        {
+            TRACE_SCOPE("spill frames");
+            spillFile = createTemporaryFile();
+            spill.reset(new FrameCacheWriter(spillFile));
+            for (auto it = frames.begin(); it != frames.end(); ++it)
+                spill->append(*it);
+            frames.clear(); // releases the decoded planes
+        }
+    }
+
+    if (spill)
+    {
+        bool bWritten = spill->finish();
+        if (bWritten)
+            mapWritten(spillFile, count);
+        remove(spillFile.c_str()); // the mapping keeps the data
+        if (!bWritten)
+            throw runtime_error("could not write the temporary frame file " + spillFile);
+    }
+}
+
+void FrameStore::loadRaw(const std::string &cacheFile)
+{
+    TRACE_SCOPE("map frame cache");
+    unmap();
+
+    struct stat cacheStat;
+    if (stat(cacheFile.c_str(), &cacheStat) != 0 || (size_t)cacheStat.st_size < sizeof(FrameCacheHeader)
+        || !mapFile(cacheFile, (size_t)cacheStat.st_size, 0))
+        throw runtime_error("not a valid raw frame file " + cacheFile);
+}
+
+void FrameStore::loadAndCache(FrameSource &source, const std::vector<std::string> &filenames,
+                              const std::string &cacheFile)
+{
+    TRACE_SCOPE("write frame cache");
+    unmap();
+
+    // write to a temporary file first, so concurrent runs never map a partially written cache
+    string tmpFile = cacheFile + ".tmp";
+    FrameCacheWriter writer(tmpFile);
+    if (!writer.good())
+    {
+        cout << "Could not create frame cache " << cacheFile << ", frames are kept in memory" << endl;
+        load(source); // the cache is optional
+        return;
+    }
+
+    // the decoded frames are kept until the cache is mapped, the source can not be read again if writing fails
+    uint64_t hash = sourceHash(filenames); // before reading, an image changed meanwhile must not match
+    cv::Mat img;
+    while (source.read(img))
+    {
+        writer.append(img);
+        frames.push_back(img);
+    }
+    if (!writer.finish(hash) || rename(tmpFile.c_str(), cacheFile.c_str()) != 0)
+    {
+        remove(tmpFile.c_str());
+        cout << "Could not write frame cache " << cacheFile << ", frames are kept in memory" << endl;
+        return;
+    }
+    frames.clear(); // releases the decoded planes, the mapping replaces them
+    mapWritten(cacheFile, writer.size());
+}
+
+bool FrameStore::mapCache(const std::vector<std::string> &filenames, const std::string &cacheFile)
+{
+    TRACE_SCOPE("map frame cache");
+    unmap();
+
+    struct stat cacheStat;
+    if (stat(cacheFile.c_str(), &cacheStat) != 0 || (size_t)cacheStat.st_size < sizeof(FrameCacheHeader))
+        return false;
+    return mapFile(cacheFile, (size_t)cacheStat.st_size, filenames.size(), sourceHash(filenames));
+}
+
+bool FrameStore::mapFile(const std::string &cacheFile, size_t fileSize, size_t expectedFrames, uint64_t expectedHash)
+{
+    int fd = open(cacheFile.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    // writable private mapping: frames are handed out as mutable cv::Mat, a write only changes a private copy of the
+    // page and never reaches the file
+    void *data = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid
+    if (data == MAP_FAILED)
+        return false;
+    mappedData = data;
+    mappedSize = fileSize;
+
+    uint8_t *base = static_cast<uint8_t *>(data);
+    const FrameCacheHeader *header = reinterpret_cast<const FrameCacheHeader *>(base);
+    if (memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0 || header->version != cacheVersion
+        || (expectedFrames > 0 && header->frameCount != expectedFrames)
+        || (expectedHash != 0 && header->sourceHash != expectedHash)
+        || header->tableOffset < sizeof(FrameCacheHeader) || header->tableOffset % cacheAlignment != 0
+        || header->tableOffset > fileSize
+        || (fileSize - header->tableOffset) / sizeof(FrameCacheEntry) < header->frameCount)
+    {
+        unmap();
+        return false;
+    }
+
+    const FrameCacheEntry *entries = reinterpret_cast<const FrameCacheEntry *>(base + header->tableOffset);
+    frames.reserve(header->frameCount);
+    for (uint32_t i = 0; i < header->frameCount; i++)
+    {
+        const FrameCacheEntry &entry = entries[i];
+        if (entry.rows < 0 || entry.cols < 0 || entry.offset + (uint64_t)entry.rows * entry.cols > fileSize)
+        {
+            unmap();
+            return false;
+        }
+
+        // header onto the mapped plane, no copy
+        frames.push_back(cv::Mat(entry.rows, entry.cols, CV_8UC1, base + entry.offset));
+    }
+    return true;
+}
+
+void FrameStore::mapWritten(const std::string &cacheFile, size_t expectedFrames)
+{
+    struct stat cacheStat;
+    if (stat(cacheFile.c_str(), &cacheStat) != 0 || !mapFile(cacheFile, (size_t)cacheStat.st_size, 0)
+        || frames.size() != expectedFrames)
+    {
+        unmap();
+        throw runtime_error("could not map frame file " + cacheFile);
+    }
+}
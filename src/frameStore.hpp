@@ -0,0 +1,56 @@
+#ifndef frameStore_hpp
+#define frameStore_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+class FrameSource;
+
+// Decoded grayscale frames, shared by all detector/descriptor combinations and threads
+// Every image is read and converted once. Optionally the grayscale planes are persisted as a raw cache file which is
+// memory-mapped on the next run, so no PNG has to be decoded at all. Sequences larger than the memory budget are
+// streamed into a temporary file of the same format and mapped as well, so the page cache instead of the heap holds
+// them. frame() returns headers onto the stored planes, the pixel data is never copied. The store is read-only after
+// loading and must outlive all users of its frames.
+class FrameStore
+{
+public:
+    FrameStore();
+    ~FrameStore();
+
+    FrameStore(const FrameStore &) = delete;
+    FrameStore &operator=(const FrameStore &) = delete;
+
+    // read up to maxFrames frames (0: all) from the source and keep them. Once the frames exceed memoryBudget bytes
+    // (0: unlimited) all of them are moved to a temporary mapped file, frames of mapped sources do not count.
+    void load(FrameSource &source, size_t maxFrames = 0, size_t memoryBudget = 0);
+
+    // map the cache file if it is valid for these images, false if it has to be (re)built
+    bool mapCache(const std::vector<std::string> &filenames, const std::string &cacheFile);
+
+    // read all frames of the source (decoded from these images) into a new cache file and map it, frames are written
+    // as they are read. If the cache can not be written the decoded frames are kept in memory instead.
+    void loadAndCache(FrameSource &source, const std::vector<std::string> &filenames, const std::string &cacheFile);
+
+    // map a cache file written by loadAndCache without checking it against images, throws std::runtime_error if invalid
+    void loadRaw(const std::string &cacheFile);
+
+    size_t size() const { return frames.size(); }
+    const cv::Mat &frame(size_t index) const { return frames[index]; }
+
+private:
+    // expectedFrames 0: any, expectedHash 0: any source
+    bool mapFile(const std::string &cacheFile, size_t fileSize, size_t expectedFrames, uint64_t expectedHash = 0);
+    void mapWritten(const std::string &cacheFile, size_t expectedFrames); // throws std::runtime_error on failure
+    void unmap();
+
+    std::vector<cv::Mat> frames;
+
+    void *mappedData; // raw cache file mapping, frames point into it
+    size_t mappedSize;
+};
+
+#endif /* frameStore_hpp */
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "guidedMatching.hpp"
+#include "simdMatching.hpp"
+
+using namespace std;
+
+static float l2Distance(const float *a, const float *b, int length)
+{
+    float sum = 0.0f;
+    for (int i = 0; i < length; i++)
+    {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sqrt(sum);
+}
+
+void GuidedMatcher::buildGrid(const std::vector<cv::KeyPoint> &keypoints, float size)
+{
+    // grid covers the bounding box of the reference keypoints
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for (auto it = keypoints.begin(); it != keypoints.end(); ++it)
+    {
+        minX = min(minX, (*it).pt.x);
+        minY = min(minY, (*it).pt.y);
+        maxX = max(maxX, (*it).pt.x);
+        maxY = max(maxY, (*it).pt.y);
+    }
+
+    cellSize = max(1.0f, size);
+    gridOrigin = cv::Point2f(minX, minY);
+    gridCols = (int)((maxX - minX) / cellSize) + 1;
+    gridRows = (int)((maxY - minY) / cellSize) + 1;
+
+    // counting sort of the keypoints by cell
+    cellStart.assign(gridCols * gridRows + 1, 0);
+    kptCell.resize(keypoints.size());
+    for (size_t i = 0; i < keypoints.size(); i++)
+    {
+        int col = (int)((keypoints[i].pt.x - gridOrigin.x) / cellSize);
+        int row = (int)((keypoints[i].pt.y - gridOrigin.y) / cellSize);
+        kptCell[i] = row * gridCols + col;
+        cellStart[kptCell[i] + 1]++;
+    }
+    for (size_t c = 1; c < cellStart.size(); c++)
+        cellStart[c] += cellStart[c - 1];
+
+    // scatter, every cell start is advanced to the start of the next cell and shifted back afterwards
+    cellItems.resize(keypoints.size());
+    for (size_t i = 0; i < keypoints.size(); i++)
+        cellItems[cellStart[kptCell[i]]++] = (int)i;
+    for (int c = gridCols * gridRows; c > 0; c--)
+        cellStart[c] = cellStart[c - 1];
+    cellStart[0] = 0;
+}
+
+void GuidedMatcher::match(const std::vector<cv::KeyPoint> &kptsSource, const cv::Mat &descSource, const std::vector<cv::Point2f> &motion,
+                          const std::vector<cv::KeyPoint> &kptsRef, const cv::Mat &descRef, float searchRadius,
+                          double minDescDistRatio, std::vector<cv::DMatch> &matches, int normType)
+{
+    // a frame without keypoints has a 0x0 CV_8U descriptor matrix, whatever the descriptor type
+    if (kptsSource.empty() || kptsRef.empty() || descSource.empty() || descRef.empty())
+        return;
+    CV_Assert(descSource.type() == descRef.type() && descSource.cols == descRef.cols);
+    CV_Assert(descSource.type() == CV_8U || descSource.type() == CV_32F);
+    CV_Assert((int)kptsSource.size() == descSource.rows && (int)kptsRef.size() == descRef.rows);
+
+    buildGrid(kptsRef, searchRadius);
+
+    bool bBinary = descSource.type() == CV_8U && normType == cv::NORM_HAMMING;
+    bool bQuantized = descSource.type() == CV_8U && !bBinary;
+    bool bPredicted = motion.size() == kptsSource.size();
+    bool bRatioTest = minDescDistRatio > 0;
+    float radiusSq = searchRadius * searchRadius;
+    matches.reserve(matches.size() + kptsSource.size());
+
+    for (size_t q = 0; q < kptsSource.size(); q++)
+    {
+        cv::Point2f predicted = kptsSource[q].pt;
+        if (bPredicted)
+            predicted += motion[q];
+
+        // cells overlapping the search window
+        int col0 = max(0, (int)floor((predicted.x - searchRadius - gridOrigin.x) / cellSize));
+        int col1 = min(gridCols - 1, (int)floor((predicted.x + searchRadius - gridOrigin.x) / cellSize));
+        int row0 = max(0, (int)floor((predicted.y - searchRadius - gridOrigin.y) / cellSize));
+        int row1 = min(gridRows - 1, (int)floor((predicted.y + searchRadius - gridOrigin.y) / cellSize));
+
+        float best = FLT_MAX, second = FLT_MAX;
+        int bestIdx = -1;
+        for (int row = row0; row <= row1; row++)
+        {
+            for (int col = col0; col <= col1; col++)
+            {
+                int cell = row * gridCols + col;
+                for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++)
+                {
+                    int r = cellItems[k];
+                    cv::Point2f d = kptsRef[r].pt - predicted;
+                    if (d.x * d.x + d.y * d.y > radiusSq)
+                        continue;
+
+                    float dist;
+                    if (bBinary)
+                        dist = (float)hammingDistance(descSource.ptr<uchar>((int)q), descRef.ptr<uchar>(r), descSource.cols);
+                    else if (bQuantized)
+                        dist = sqrt((float)l2SquaredDistance(descSource.ptr<uchar>((int)q), descRef.ptr<uchar>(r), descSource.cols));
+                    else
+                        dist = l2Distance(descSource.ptr<float>((int)q), descRef.ptr<float>(r), descSource.cols);
+                    if (dist < best)
+                    {
+                        second = best;
+                        best = dist;
+                        bestIdx = r;
+                    }
+                    else if (dist < second)
+                        second = dist;
+                }
+            }
+        }
+
+        if (bestIdx < 0)
+            continue;
+        // a single candidate in the window passes, the window already rules out all other keypoints
+        if (bRatioTest && second < FLT_MAX && best >= minDescDistRatio * second)
+            continue;
+        matches.push_back(cv::DMatch((int)q, bestIdx, best));
+    }
+}
+
+void estimateKeypointMotion(const std::vector<cv::KeyPoint> &kptsSource, const std::vector<cv::KeyPoint> &kptsRef,
+                            const std::vector<cv::DMatch> &matches, std::vector<cv::Point2f> &motion)
+{
+    motion.clear();
+    if (matches.empty())
+        return;
+
+    vector<float> dx, dy;
+    dx.reserve(matches.size());
+    dy.reserve(matches.size());
+    for (auto it = matches.begin(); it != matches.end(); ++it)
+    {
+        cv::Point2f d = kptsRef[(*it).trainIdx].pt - kptsSource[(*it).queryIdx].pt;
+        dx.push_back(d.x);
+        dy.push_back(d.y);
+    }
+
+    // per component median, robust against the false matches among them
+    size_t mid = dx.size() / 2;
+    nth_element(dx.begin(), dx.begin() + mid, dx.end());
+    nth_element(dy.begin(), dy.begin() + mid, dy.end());
+    motion.assign(kptsRef.size(), cv::Point2f(dx[mid], dy[mid]));
+
+    for (auto it = matches.begin(); it != matches.end(); ++it)
+        motion[(*it).trainIdx] = kptsRef[(*it).trainIdx].pt - kptsSource[(*it).queryIdx].pt;
+}
@@ -0,0 +1,45 @@
+#ifndef guidedMatching_hpp
+#define guidedMatching_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+
+// Motion-guided windowed descriptor matching
+// The reference keypoints are bucketed into a grid of square cells. Every source keypoint is moved by its predicted
+// motion and only compared with the reference keypoints within the search radius around the predicted position, so
+// the cost grows with the number of keypoints instead of with their product. Binary descriptors (CV_8U) are compared
+// with the Hamming distance, float descriptors (CV_32F) and quantized gradient descriptors (CV_8U with NORM_L2)
+// with the L2 distance.
+class GuidedMatcher
+{
+public:
+    // motion: displacement of every source keypoint into the reference frame, empty if there is no prediction
+    // minDescDistRatio > 0 applies the descriptor distance ratio test to the candidates in the window (a single
+    // candidate is kept), otherwise the nearest candidate is kept
+    // normType: cv::NORM_HAMMING or cv::NORM_L2, only needed for CV_8U descriptors (CV_32F always use L2)
+    void match(const std::vector<cv::KeyPoint> &kptsSource, const cv::Mat &descSource, const std::vector<cv::Point2f> &motion,
+               const std::vector<cv::KeyPoint> &kptsRef, const cv::Mat &descRef, float searchRadius,
+               double minDescDistRatio, std::vector<cv::DMatch> &matches, int normType = cv::NORM_HAMMING);
+
+private:
+    void buildGrid(const std::vector<cv::KeyPoint> &keypoints, float cellSize);
+
+    cv::Point2f gridOrigin;
+    float cellSize;
+    int gridCols, gridRows;
+
+    // reference keypoints sorted by cell, the keypoints of cell c are cellItems[cellStart[c] .. cellStart[c + 1])
+    std::vector<int> cellStart;
+    std::vector<int> cellItems;
+    std::vector<int> kptCell;
+};
+
+// Constant velocity model for the next guided match
+// The motion of every matched reference keypoint is its displacement from the source keypoint, unmatched keypoints
+// move with the median motion. Leaves motion empty if there are no matches.
+void estimateKeypointMotion(const std::vector<cv::KeyPoint> &kptsSource, const std::vector<cv::KeyPoint> &kptsRef,
+                            const std::vector<cv::DMatch> &matches, std::vector<cv::Point2f> &motion);
+
+#endif /* guidedMatching_hpp */
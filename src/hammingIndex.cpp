@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <climits>
+#include <random>
+
+#include "hammingIndex.hpp"
+#include "simdMatching.hpp"
+#include "tracing.hpp"
+
+using namespace std;
+
+HammingLshIndex::HammingLshIndex(int tableCount, int keyBits, int multiProbeLevel)
+    : tableCount(tableCount), keyBits(min(keyBits, 32)), multiProbeLevel(multiProbeLevel), sampledBits(0)
+{
+}
+
+HammingLshIndex::HammingLshIndex(const cv::Mat &descriptors, int tableCount, int keyBits, int multiProbeLevel)
+    : HammingLshIndex(tableCount, keyBits, multiProbeLevel)
+{
+    build(descriptors);
+}
+
+void HammingLshIndex::build(const cv::Mat &descriptors)
+{
+    TRACE_SCOPE("build LSH index");
+    CV_Assert(descriptors.empty() || descriptors.depth() == CV_8U);
+    this->descriptors = descriptors;
+    for (auto it = tables.begin(); it != tables.end(); ++it)
+        (*it).clear();
+    int totalBits = descriptors.cols * 8;
+    if (totalBits == 0)
+        return;
+
+    // fixed seed, so matching results are reproducible between runs, the bits only change with the descriptor length
+    if (totalBits != sampledBits)
+    {
+        mt19937 rng(42);
+        uniform_int_distribution<int> bitDist(0, totalBits - 1);
+        bitPositions.resize(tableCount * keyBits);
+        for (auto it = bitPositions.begin(); it != bitPositions.end(); ++it)
+            *it = bitDist(rng);
+        sampledBits = totalBits;
+    }
+
+    tables.resize(tableCount);
+    for (int t = 0; t < tableCount; t++)
+    {
+        tables[t].reserve(descriptors.rows);
+        for (int r = 0; r < descriptors.rows; r++)
+            tables[t].push_back(BucketEntry(hashKey(descriptors.ptr<uchar>(r), t), r));
+        sort(tables[t].begin(), tables[t].end());
+    }
+}
+
+uint32_t HammingLshIndex::hashKey(const uchar *desc, int table) const
+{
+    const int *bits = &bitPositions[table * keyBits];
+    uint32_t key = 0;
+    for (int k = 0; k < keyBits; k++)
+        key |= (uint32_t)((desc[bits[k] >> 3] >> (bits[k] & 7)) & 1) << k;
+    return key;
+}
+
+int HammingLshIndex::searchBestTwo(const uchar *query, std::vector<uint32_t> &visited, uint32_t stamp,
+                                   int &bestIdx, int &best, int &second) const
+{
+    bestIdx = -1;
+    best = INT_MAX;
+    second = INT_MAX;
+    int candidates = 0;
+
+    int probesPerTable = multiProbeLevel > 0 ? keyBits + 1 : 1;
+    for (int t = 0; t < tableCount; t++)
+    {
+        uint32_t key = hashKey(query, t);
+        for (int p = 0; p < probesPerTable; p++)
+        {
+            uint32_t probeKey = p == 0 ? key : key ^ (1u << (p - 1));
+            auto bucket = equal_range(tables[t].begin(), tables[t].end(), BucketEntry(probeKey, INT_MIN),
+                                      [](const BucketEntry &a, const BucketEntry &b) { return a.first < b.first; });
+
+            for (auto it = bucket.first; it != bucket.second; ++it)
+            {
+                int r = (*it).second;
+                if (visited[r] == stamp)
+                    continue; // already compared via another table
+                visited[r] = stamp;
+                candidates++;
+
+                int dist = hammingDistance(query, descriptors.ptr<uchar>(r), descriptors.cols);
+                if (dist < best || (dist == best && r < bestIdx))
+                {
+                    second = best;
+                    best = dist;
+                    bestIdx = r;
+                }
+                else if (dist < second)
+                    second = dist;
+            }
+        }
+    }
+    return candidates;
+}
+
+void HammingLshIndex::matchNN(const cv::Mat &descSource, std::vector<cv::DMatch> &matches) const
+{
+    CV_Assert(descSource.depth() == CV_8U && (descriptors.empty() || descSource.cols == descriptors.cols));
+    if (descriptors.empty())
+        return;
+
+    vector<uint32_t> visited(descriptors.rows, 0);
+    for (int q = 0; q < descSource.rows; q++)
+    {
+        int bestIdx, best, second;
+        if (searchBestTwo(descSource.ptr<uchar>(q), visited, q + 1, bestIdx, best, second) > 0)
+            matches.push_back(cv::DMatch(q, bestIdx, (float)best));
+    }
+}
+
+void HammingLshIndex::matchKnnRatio(const cv::Mat &descSource, std::vector<cv::DMatch> &matches, double minDescDistRatio) const
+{
+    CV_Assert(descSource.depth() == CV_8U && (descriptors.empty() || descSource.cols == descriptors.cols));
+    if (descriptors.empty())
+        return;
+
+    vector<uint32_t> visited(descriptors.rows, 0);
+    for (int q = 0; q < descSource.rows; q++)
+    {
+        int bestIdx, best, second;
+        int candidates = searchBestTwo(descSource.ptr<uchar>(q), visited, q + 1, bestIdx, best, second);
+
+        // descriptor distance ratio test
+        if (candidates > 1 && best < minDescDistRatio * second)
+            matches.push_back(cv::DMatch(q, bestIdx, (float)best));
+    }
+}
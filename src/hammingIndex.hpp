@@ -0,0 +1,52 @@
+#ifndef hammingIndex_hpp
+#define hammingIndex_hpp
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+
+// Approximate nearest neighbour index for packed binary descriptors (CV_8U rows), locality sensitive hashing
+// Every table hashes a descriptor by a fixed random subset of its bits. A query is hashed the same way, and with
+// multi-probing also every key at Hamming distance 1, and only the descriptors in those buckets are compared with
+// the exact Hamming distance. The index keeps a header onto the descriptors instead of copying them.
+class HammingLshIndex
+{
+public:
+    explicit HammingLshIndex(int tableCount = 8, int keyBits = 16, int multiProbeLevel = 1); // empty index
+    explicit HammingLshIndex(const cv::Mat &descriptors, int tableCount = 8, int keyBits = 16, int multiProbeLevel = 1);
+
+    // index other descriptors, the tables keep their capacity so rebuilding for every frame does not allocate
+    void build(const cv::Mat &descriptors);
+
+    int size() const { return descriptors.rows; }
+    int descriptorBytes() const { return descriptors.cols; }
+
+    // nearest neighbor among the candidates of every source descriptor (if any candidate was found)
+    void matchNN(const cv::Mat &descSource, std::vector<cv::DMatch> &matches) const;
+
+    // best candidate which passes the descriptor distance ratio test, queries with less than two candidates are dropped
+    void matchKnnRatio(const cv::Mat &descSource, std::vector<cv::DMatch> &matches, double minDescDistRatio) const;
+
+private:
+    typedef std::pair<uint32_t, int> BucketEntry; // hash key, descriptor row
+
+    uint32_t hashKey(const uchar *desc, int table) const;
+
+    // best and second best candidate, returns the number of candidates compared
+    int searchBestTwo(const uchar *query, std::vector<uint32_t> &visited, uint32_t stamp,
+                      int &bestIdx, int &best, int &second) const;
+
+    cv::Mat descriptors; // shares the indexed descriptor data
+    int tableCount;
+    int keyBits;
+    int multiProbeLevel; // 0: exact bucket only, 1: also all buckets at key distance 1
+
+    std::vector<int> bitPositions;              // tableCount x keyBits sampled bit indices
+    int sampledBits;                            // descriptor length in bits the positions were sampled for
+    std::vector<std::vector<BucketEntry>> tables; // per table, sorted by key
+};
+
+#endif /* hammingIndex_hpp */
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <cfloat>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+// the AVX2 kernels are compiled with a target attribute and selected from the CPU features at runtime, so they are
+// used without -march=native (same scheme as the SIMD matcher)
+#define HARRIS_DISPATCH
+#define HARRIS_AVX2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#else
+#if defined(__AVX2__)
+#define HARRIS_AVX2
+#include <immintrin.h>
+#endif
+#define TARGET_AVX2
+#endif
+
+#include "harrisFused.hpp"
+#include "keypointNMS.hpp"
+
+using namespace std;
+
+// index mapping of cv::BORDER_REFLECT_101 (cv::BORDER_DEFAULT), valid for n >= 2
+static inline int reflect101(int i, int n)
+{
+    return i < 0 ? -i : (i >= n ? 2 * n - 2 - i : i);
+}
+
+// row kernels of one instruction set
+struct HarrisKernels {
+    const char *name;
+    // Sobel products of the interior columns x = 1 .. from the rows above (a), at (b) and below (c), returns the
+    // first column not done
+    int (*sobelProducts)(const uchar *a, const uchar *b, const uchar *c, int w, float scale, float *xx, float *xy, float *yy);
+    // response of one row from the horizontal sums of two rows, updates the response range
+    void (*responseRow)(const float *prev, const float *cur, int w, float k, float *r, float &minR, float &maxR);
+    // columns whose normalized response reaches the threshold, in order
+    void (*candidates)(const float *r, int w, float normScale, float normShift, float threshold, std::vector<int> &columns);
+};
+
+static int sobelProductsScalar(const uchar *, const uchar *, const uchar *, int, float, float *, float *, float *)
+{
+    return 1; // the caller's scalar loop does all columns
+}
+
+static void responseRowScalar(const float *prev, const float *cur, int w, float k, float *r, float &minR, float &maxR)
+{
+    const float *pXX = prev, *pXY = prev + w, *pYY = prev + 2 * w;
+    const float *cXX = cur, *cXY = cur + w, *cYY = cur + 2 * w;
+    for (int x = 0; x < w; x++)
+    {
+        float sxx = pXX[x] + cXX[x], sxy = pXY[x] + cXY[x], syy = pYY[x] + cYY[x];
+        float resp = sxx * syy - sxy * sxy - k * (sxx + syy) * (sxx + syy);
+        r[x] = resp;
+        minR = min(minR, resp);
+        maxR = max(maxR, resp);
+    }
+}
+
+static void candidatesScalar(const float *r, int w, float normScale, float normShift, float threshold, std::vector<int> &columns)
+{
+    for (int x = 0; x < w; x++)
+        if (r[x] * normScale + normShift >= threshold)
+            columns.push_back(x);
+}
+
+#if defined(HARRIS_AVX2)
+static inline int lowestBit(int mask)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, (unsigned long)mask);
+    return (int)idx;
+#else
+    return __builtin_ctz((unsigned int)mask);
+#endif
+}
+
+TARGET_AVX2 static inline __m256 load8(const uchar *p)
+{
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p)));
+}
+
+TARGET_AVX2 static int sobelProductsAvx2(const uchar *a, const uchar *b, const uchar *c, int w, float scale, float *xx, float *xy, float *yy)
+{
+    const __m256 two = _mm256_set1_ps(2.0f), vScale = _mm256_set1_ps(scale);
+    int x = 1;
+    for (; x + 8 <= w - 1; x += 8)
+    {
+        __m256 aL = load8(a + x - 1), aC = load8(a + x), aR = load8(a + x + 1);
+        __m256 bL = load8(b + x - 1), bR = load8(b + x + 1);
+        __m256 cL = load8(c + x - 1), cC = load8(c + x), cR = load8(c + x + 1);
+
+        __m256 dx = _mm256_add_ps(_mm256_add_ps(_mm256_sub_ps(aR, aL), _mm256_mul_ps(two, _mm256_sub_ps(bR, bL))), _mm256_sub_ps(cR, cL));
+        __m256 dy = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(cL, _mm256_mul_ps(two, cC)), cR),
+                                  _mm256_add_ps(_mm256_add_ps(aL, _mm256_mul_ps(two, aC)), aR));
+        dx = _mm256_mul_ps(dx, vScale);
+        dy = _mm256_mul_ps(dy, vScale);
+
+        _mm256_storeu_ps(xx + x, _mm256_mul_ps(dx, dx));
+        _mm256_storeu_ps(xy + x, _mm256_mul_ps(dx, dy));
+        _mm256_storeu_ps(yy + x, _mm256_mul_ps(dy, dy));
+    }
+    return x;
+}
+
+TARGET_AVX2 static void responseRowAvx2(const float *prev, const float *cur, int w, float k, float *r, float &minR, float &maxR)
+{
+    const float *pXX = prev, *pXY = prev + w, *pYY = prev + 2 * w;
+    const float *cXX = cur, *cXY = cur + w, *cYY = cur + 2 * w;
+    const __m256 vk = _mm256_set1_ps(k);
+    __m256 vMin = _mm256_set1_ps(FLT_MAX), vMax = _mm256_set1_ps(-FLT_MAX);
+    int x = 0;
+    for (; x + 8 <= w; x += 8)
+    {
+        __m256 sxx = _mm256_add_ps(_mm256_loadu_ps(pXX + x), _mm256_loadu_ps(cXX + x));
+        __m256 sxy = _mm256_add_ps(_mm256_loadu_ps(pXY + x), _mm256_loadu_ps(cXY + x));
+        __m256 syy = _mm256_add_ps(_mm256_loadu_ps(pYY + x), _mm256_loadu_ps(cYY + x));
+        __m256 trace = _mm256_add_ps(sxx, syy);
+        __m256 resp = _mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(sxx, syy), _mm256_mul_ps(sxy, sxy)),
+                                    _mm256_mul_ps(vk, _mm256_mul_ps(trace, trace)));
+        _mm256_storeu_ps(r + x, resp);
+        vMin = _mm256_min_ps(vMin, resp);
+        vMax = _mm256_max_ps(vMax, resp);
+    }
+    float lanesMin[8], lanesMax[8];
+    _mm256_storeu_ps(lanesMin, vMin);
+    _mm256_storeu_ps(lanesMax, vMax);
+    for (int i = 0; i < 8; i++)
+    {
+        minR = min(minR, lanesMin[i]);
+        maxR = max(maxR, lanesMax[i]);
+    }
+    for (; x < w; x++)
+    {
+        float sxx = pXX[x] + cXX[x], sxy = pXY[x] + cXY[x], syy = pYY[x] + cYY[x];
+        float resp = sxx * syy - sxy * sxy - k * (sxx + syy) * (sxx + syy);
+        r[x] = resp;
+        minR = min(minR, resp);
+        maxR = max(maxR, resp);
+    }
+}
+
+TARGET_AVX2 static void candidatesAvx2(const float *r, int w, float normScale, float normShift, float threshold, std::vector<int> &columns)
+{
+    const __m256 vScale = _mm256_set1_ps(normScale), vShift = _mm256_set1_ps(normShift), vThreshold = _mm256_set1_ps(threshold);
+    int x = 0;
+    for (; x + 8 <= w; x += 8)
+    {
+        __m256 norm = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(r + x), vScale), vShift);
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(norm, vThreshold, _CMP_GE_OQ));
+        while (mask) // most blocks have no candidate
+        {
+            columns.push_back(x + lowestBit(mask));
+            mask &= mask - 1;
+        }
+    }
+    for (; x < w; x++)
+        if (r[x] * normScale + normShift >= threshold)
+            columns.push_back(x);
+}
+#endif
+
+static HarrisKernels selectKernels()
+{
+#if defined(HARRIS_AVX2)
+#if defined(HARRIS_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+#endif
+        return HarrisKernels{"AVX2", sobelProductsAvx2, responseRowAvx2, candidatesAvx2};
+#endif
+    return HarrisKernels{"scalar", sobelProductsScalar, responseRowScalar, candidatesScalar};
+}
+
+static const HarrisKernels &harrisKernels()
+{
+    static const HarrisKernels kernels = selectKernels(); // once per process, thread safe
+    return kernels;
+}
+
+const char *FusedHarris::implementation()
+{
+    return harrisKernels().name;
+}
+
+void FusedHarris::tensorRow(const cv::Mat &img, int y, float *sumXX, float *sumXY, float *sumYY)
+{
+    const int w = img.cols;
+    const uchar *a = img.ptr<uchar>(reflect101(y - 1, img.rows));
+    const uchar *b = img.ptr<uchar>(y);
+    const uchar *c = img.ptr<uchar>(reflect101(y + 1, img.rows));
+
+    // cornerHarris scales the 8 bit Sobel output by 1 / (2^(apertureSize - 1) * blockSize * 255)
+    const float scale = 1.0f / (4 * 2 * 255.0f);
+    float *xx = &prodXX[0], *xy = &prodXY[0], *yy = &prodYY[0];
+
+    auto sobelAt = [&](int x) {
+        int l = reflect101(x - 1, w), r = reflect101(x + 1, w);
+        float dx = (float)((a[r] - a[l]) + 2 * (b[r] - b[l]) + (c[r] - c[l])) * scale;
+        float dy = (float)((c[l] + 2 * c[x] + c[r]) - (a[l] + 2 * a[x] + a[r])) * scale;
+        xx[x] = dx * dx;
+        xy[x] = dx * dy;
+        yy[x] = dy * dy;
+    };
+
+    sobelAt(0);
+    for (int x = harrisKernels().sobelProducts(a, b, c, w, scale, xx, xy, yy); x < w; x++)
+        sobelAt(x);
+
+    // 2x2 box filter, horizontal part: anchor at the right column, column -1 reflects to column 1
+    sumXX[0] = xx[1] + xx[0];
+    sumXY[0] = xy[1] + xy[0];
+    sumYY[0] = yy[1] + yy[0];
+    for (int x = 1; x < w; x++)
+    {
+        sumXX[x] = xx[x - 1] + xx[x];
+        sumXY[x] = xy[x - 1] + xy[x];
+        sumYY[x] = yy[x - 1] + yy[x];
+    }
+}
+
+void FusedHarris::detect(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, double k, int minResponse,
+                         float keypointSize, double maxOverlap)
+{
+    computeResponse(img, k);
+    extract(keypoints, minResponse, keypointSize, maxOverlap, minR, maxR);
+}
+
+void FusedHarris::computeResponse(const cv::Mat &img, double k)
+{
+    CV_Assert(img.type() == CV_8UC1);
+    w = img.cols, h = img.rows;
+    minR = FLT_MAX, maxR = -FLT_MAX;
+    if (w < 2 || h < 2)
+    {
+        w = h = 0;
+        return;
+    }
+
+    response.resize((size_t)w * h);
+    prodXX.resize(w);
+    prodXY.resize(w);
+    prodYY.resize(w);
+    rowSums.resize(6 * (size_t)w);
+
+    // horizontal sums of the previous and the current row, swapped from row to row
+    float *prev = &rowSums[0], *cur = &rowSums[3 * (size_t)w];
+    const float kf = (float)k;
+
+    // #### pass 1: gradients, structure tensor and response, row by row ####
+    for (int y = 0; y < h; y++)
+    {
+        if (y == 0)
+        {
+            tensorRow(img, 0, cur, cur + w, cur + 2 * w);
+            tensorRow(img, 1, prev, prev + w, prev + 2 * w); // row -1 reflects to row 1
+        }
+        else
+        {
+            swap(prev, cur);
+            tensorRow(img, y, cur, cur + w, cur + 2 * w);
+        }
+
+        harrisKernels().responseRow(prev, cur, w, kf, &response[(size_t)y * w], minR, maxR);
+    }
+}
+
+void FusedHarris::extract(std::vector<cv::KeyPoint> &keypoints, int minResponse, float keypointSize, double maxOverlap,
+                          double rangeMin, double rangeMax)
+{
+    if (w == 0 || h == 0)
+        return;
+
+    // #### pass 2: min-max normalization to 0..255, threshold and NMS ####
+    double range = rangeMax - rangeMin;
+    float normScale = (float)(range > DBL_EPSILON ? 255.0 / range : 0.0);
+    float normShift = (float)(0.0 - rangeMin * (double)normScale);
+    float threshold = (float)(minResponse + 1); // (int)norm > minResponse for norm >= 0
+
+    KeypointGridNMS nms(keypoints, cv::Size(w, h), keypointSize, maxOverlap);
+    auto addCandidate = [&](int x, int y, float norm) {
+        cv::KeyPoint newKeyPoint;
+        newKeyPoint.pt = cv::Point2f(x, y);
+        newKeyPoint.size = keypointSize;
+        newKeyPoint.response = (int)norm;
+        nms.insert(newKeyPoint);
+    };
+
+    const HarrisKernels &kernels = harrisKernels();
+    for (int y = 0; y < h; y++)
+    {
+        const float *r = &response[(size_t)y * w];
+        candidateColumns.clear();
+        kernels.candidates(r, w, normScale, normShift, threshold, candidateColumns);
+        for (auto it = candidateColumns.begin(); it != candidateColumns.end(); ++it)
+            addCandidate(*it, y, r[*it] * normScale + normShift);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef harrisFused_hpp
+#define harrisFused_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+
+// Harris corner detector with a fused response kernel
+// Same response as cv::cornerHarris(img, dst, 2, 3, k) followed by cv::normalize(NORM_MINMAX, 0..255): Sobel
+// gradients, structure tensor products, the 2x2 box sum and the Harris response are computed row by row in one pass,
+// the only full frame buffer is the response itself. A second pass thresholds the normalized response and feeds the
+// candidates in raster order into the grid NMS. The AVX2 row kernels are selected at runtime from the CPU features.
+// All scratch buffers are members and keep their size between frames of the same resolution.
+class FusedHarris
+{
+public:
+    // img: 8 bit grayscale, at least 2x2 pixels; keypoints are appended after NMS with the given max. overlap
+    void detect(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, double k, int minResponse,
+                float keypointSize, double maxOverlap);
+
+    // the two passes of detect() on their own, so several images can be normalized with a common range:
+    // computeResponse() keeps the response of img, extract() normalizes it with [rangeMin, rangeMax] to 0..255
+    void computeResponse(const cv::Mat &img, double k);
+    void extract(std::vector<cv::KeyPoint> &keypoints, int minResponse, float keypointSize, double maxOverlap,
+                 double rangeMin, double rangeMax);
+    float responseMin() const { return minR; } // range of the last response, min > max if it is empty
+    float responseMax() const { return maxR; }
+
+    // name of the code path selected at runtime
+    static const char *implementation();
+
+private:
+    // Sobel products of one image row and their horizontal 2-sum, rows outside the image are reflected
+    void tensorRow(const cv::Mat &img, int y, float *sumXX, float *sumXY, float *sumYY);
+
+    std::vector<float> response;                 // rows x cols Harris response
+    int w = 0, h = 0;                            // size of the response
+    float minR = 0.0f, maxR = -1.0f;
+    std::vector<float> prodXX, prodXY, prodYY;   // Sobel products of the current row
+    std::vector<float> rowSums;                  // horizontal sums of two rows, 6 x cols
+    std::vector<int> candidateColumns;           // columns above the threshold in the current row
+};
+
+#endif /* harrisFused_hpp */
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include "keypointNMS.hpp"
+
+using namespace std;
+
+KeypointGridNMS::KeypointGridNMS(std::vector<cv::KeyPoint> &keypoints, cv::Size imgSize, float cellSize, double maxOverlap)
+    : keypoints(keypoints), maxOverlap(maxOverlap), cellSize(max(cellSize, 1.0f)), maxRadius(0.0f)
+{
+    gridCols = max(1, (int)ceil(imgSize.width / this->cellSize));
+    gridRows = max(1, (int)ceil(imgSize.height / this->cellSize));
+    cellHead.assign(gridCols * gridRows, -1);
+
+    // index keypoints which are already in the list
+    nextInCell.reserve(keypoints.size());
+    kptCell.reserve(keypoints.size());
+    for (int i = 0; i < (int)keypoints.size(); ++i)
+    {
+        nextInCell.push_back(-1);
+        kptCell.push_back(-1);
+        link(i);
+        maxRadius = max(maxRadius, 0.5f * keypoints[i].size);
+    }
+}
+
+// Keypoints outside of the image are clamped to the border cells. Clamping never increases the distance
+// between two cells, so no overlapping pair can be missed.
+int KeypointGridNMS::cellIndex(const cv::Point2f &pt) const
+{
+    int cx = min(max((int)floor(pt.x / cellSize), 0), gridCols - 1);
+    int cy = min(max((int)floor(pt.y / cellSize), 0), gridRows - 1);
+    return cy * gridCols + cx;
+}
+
+void KeypointGridNMS::link(int kptIdx)
+{
+    int cell = cellIndex(keypoints[kptIdx].pt);
+    nextInCell[kptIdx] = cellHead[cell];
+    cellHead[cell] = kptIdx;
+    kptCell[kptIdx] = cell;
+}
+
+void KeypointGridNMS::unlink(int kptIdx)
+{
+    int *it = &cellHead[kptCell[kptIdx]];
+    while (*it != kptIdx)
+        it = &nextInCell[*it];
+    *it = nextInCell[kptIdx];
+}
+
+bool KeypointGridNMS::insert(const cv::KeyPoint &newKeyPoint)
+{
+    // two keypoints can only overlap if their distance is below the sum of their radii
+    float radius = 0.5f * newKeyPoint.size;
+    int reach = max(0, (int)ceil((radius + maxRadius) / cellSize));
+
+    int center = cellIndex(newKeyPoint.pt);
+    int cx = center % gridCols, cy = center / gridCols;
+
+    // the sequential loop replaces the first (lowest index) overlapping keypoint with a lower response
+    bool bOverlap = false;
+    int replaceIdx = -1;
+    for (int y = max(cy - reach, 0); y <= min(cy + reach, gridRows - 1); ++y)
+    {
+        for (int x = max(cx - reach, 0); x <= min(cx + reach, gridCols - 1); ++x)
+        {
+            for (int idx = cellHead[y * gridCols + x]; idx >= 0; idx = nextInCell[idx])
+            {
+                if (replaceIdx >= 0 && idx > replaceIdx)
+                    continue; // cannot change the outcome anymore
+
+                double kptOverlap = cv::KeyPoint::overlap(newKeyPoint, keypoints[idx]);
+                if (kptOverlap > maxOverlap)
+                {
+                    bOverlap = true;
+                    if (newKeyPoint.response > keypoints[idx].response)
+                        replaceIdx = idx;
+                }
+            }
+        }
+    }
+
+    maxRadius = max(maxRadius, radius);
+
+    if (replaceIdx >= 0)
+    { // replace old key point with new one and move it to its new cell
+        unlink(replaceIdx);
+        keypoints[replaceIdx] = newKeyPoint;
+        link(replaceIdx);
+        return true;
+    }
+
+    if (!bOverlap)
+    { // only add new key point if no overlap has been found
+        keypoints.push_back(newKeyPoint);
+        nextInCell.push_back(-1);
+        kptCell.push_back(-1);
+        link((int)keypoints.size() - 1);
+        return true;
+    }
+
+    return false;
+}
+
+void nmsKeypoints(std::vector<cv::KeyPoint> &keypoints, cv::Size imgSize, double maxOverlap)
+{
+    vector<cv::KeyPoint> candidates;
+    candidates.swap(keypoints);
+
+    float maxSize = 0.0f;
+    for (auto it = candidates.begin(); it != candidates.end(); ++it)
+        maxSize = max(maxSize, (*it).size);
+
+    KeypointGridNMS nms(keypoints, imgSize, maxSize, maxOverlap);
+    for (auto it = candidates.begin(); it != candidates.end(); ++it)
+        nms.insert(*it);
+}
+
+void nmsKeypointsReference(std::vector<cv::KeyPoint> &keypoints, const cv::KeyPoint &newKeyPoint, double maxOverlap)
+{
+    // perform non-maximum suppression (NMS) in local neighbourhood around new key point
+    bool bOverlap = false;
+    for (auto it = keypoints.begin(); it != keypoints.end(); ++it)
+    {
+        double kptOverlap = cv::KeyPoint::overlap(newKeyPoint, *it);
+        if (kptOverlap > maxOverlap)
+        {
+            bOverlap = true;
+            if (newKeyPoint.response > (*it).response)
+            {                      // if overlap is >t AND response is higher for new kpt
+                *it = newKeyPoint; // replace old key point with new one
+                break;             // quit loop over keypoints
+            }
+        }
+    }
+    if (!bOverlap)
+    {                                     // only add new key point if no overlap has been found in previous NMS
+        keypoints.push_back(newKeyPoint); // store new keypoint in dynamic list
+    }
+}
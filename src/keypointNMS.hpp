@@ -0,0 +1,46 @@
+#ifndef keypointNMS_hpp
+#define keypointNMS_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+
+// Grid-bucketed non-maximum suppression (NMS) for keypoints
+// Keypoints are hashed into square cells, so a new keypoint is only compared against keypoints in neighbouring
+// cells instead of against the full list. The result is identical to the sequential overlap loop (see
+// nmsKeypointsReference): the first overlapping keypoint with a lower response is replaced, otherwise the new
+// keypoint is dropped if it overlaps any stored keypoint.
+class KeypointGridNMS
+{
+public:
+    // keypoints already contained in the list are indexed and take part in the suppression of new keypoints
+    KeypointGridNMS(std::vector<cv::KeyPoint> &keypoints, cv::Size imgSize, float cellSize, double maxOverlap = 0.0);
+
+    // returns true if the keypoint was stored (either appended or replacing a weaker neighbour)
+    bool insert(const cv::KeyPoint &newKeyPoint);
+
+private:
+    int cellIndex(const cv::Point2f &pt) const;
+    void link(int kptIdx);
+    void unlink(int kptIdx);
+
+    std::vector<cv::KeyPoint> &keypoints; // result list, owned by the caller
+    double maxOverlap;                    // max. permissible overlap between two features in %
+
+    float cellSize;
+    int gridCols, gridRows;
+    float maxRadius;                      // largest keypoint radius seen so far, defines the neighbourhood to search
+
+    std::vector<int> cellHead;            // first keypoint index in each cell (-1 if empty)
+    std::vector<int> nextInCell;          // next keypoint index in the same cell (-1 at end of list)
+    std::vector<int> kptCell;             // cell each keypoint is currently linked into
+};
+
+// Apply grid NMS to a list of keypoints, processing them in list order
+void nmsKeypoints(std::vector<cv::KeyPoint> &keypoints, cv::Size imgSize, double maxOverlap = 0.0);
+
+// Original O(N^2) sequential NMS loop, kept as reference for validation and benchmarking
+void nmsKeypointsReference(std::vector<cv::KeyPoint> &keypoints, const cv::KeyPoint &newKeyPoint, double maxOverlap = 0.0);
+
+#endif /* keypointNMS_hpp */
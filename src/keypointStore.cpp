@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <functional>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+// the AVX2 kernels are compiled with a target attribute and selected from the CPU features at runtime, so they are
+// used without -march=native (same scheme as the SIMD matcher)
+#define KEYPOINT_STORE_DISPATCH
+#define KEYPOINT_STORE_AVX2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#else
+#if defined(__AVX2__)
+#define KEYPOINT_STORE_AVX2
+#include <immintrin.h>
+#endif
+#define TARGET_AVX2
+#endif
+
+#include "keypointStore.hpp"
+
+using namespace std;
+
+// selection kernels of one instruction set
+struct SelectionKernels {
+    const char *name;
+    // indices of the positions inside [x0, x1) x [y0, y1) after rounding
+    void (*inRect)(const float *x, const float *y, int n, int x0, int x1, int y0, int y1, std::vector<int> &selection);
+    // indices of the values >= threshold
+    void (*atLeast)(const float *values, int n, float threshold, std::vector<int> &selection);
+};
+
+static void inRectScalar(const float *x, const float *y, int n, int x0, int x1, int y0, int y1, std::vector<int> &selection)
+{
+    for (int i = 0; i < n; i++)
+    {
+        int px = cvRound(x[i]), py = cvRound(y[i]);
+        if (x0 <= px && px < x1 && y0 <= py && py < y1)
+            selection.push_back(i);
+    }
+}
+
+static void atLeastScalar(const float *values, int n, float threshold, std::vector<int> &selection)
+{
+    for (int i = 0; i < n; i++)
+        if (values[i] >= threshold)
+            selection.push_back(i);
+}
+
+#if defined(KEYPOINT_STORE_AVX2)
+static inline int lowestBit(int mask)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, (unsigned long)mask);
+    return (int)idx;
+#else
+    return __builtin_ctz((unsigned int)mask);
+#endif
+}
+
+// append base + i for every set bit i of the 8 bit mask
+static inline void appendMask(int mask, int base, std::vector<int> &selection)
+{
+    while (mask)
+    {
+        selection.push_back(base + lowestBit(mask));
+        mask &= mask - 1;
+    }
+}
+
+TARGET_AVX2 static void inRectAvx2(const float *x, const float *y, int n, int x0, int x1, int y0, int y1, std::vector<int> &selection)
+{
+    // cvtps rounds to nearest even like cvRound, so the integer test is identical to cv::Rect::contains
+    const __m256i vx0 = _mm256_set1_epi32(x0 - 1), vx1 = _mm256_set1_epi32(x1);
+    const __m256i vy0 = _mm256_set1_epi32(y0 - 1), vy1 = _mm256_set1_epi32(y1);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i px = _mm256_cvtps_epi32(_mm256_load_ps(x + i));
+        __m256i py = _mm256_cvtps_epi32(_mm256_load_ps(y + i));
+        __m256i inside = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(px, vx0), _mm256_cmpgt_epi32(vx1, px)),
+                                          _mm256_and_si256(_mm256_cmpgt_epi32(py, vy0), _mm256_cmpgt_epi32(vy1, py)));
+        appendMask(_mm256_movemask_ps(_mm256_castsi256_ps(inside)), i, selection);
+    }
+    for (; i < n; i++)
+    {
+        int px = cvRound(x[i]), py = cvRound(y[i]);
+        if (x0 <= px && px < x1 && y0 <= py && py < y1)
+            selection.push_back(i);
+    }
+}
+
+TARGET_AVX2 static void atLeastAvx2(const float *values, int n, float threshold, std::vector<int> &selection)
+{
+    const __m256 vThreshold = _mm256_set1_ps(threshold);
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        appendMask(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_load_ps(values + i), vThreshold, _CMP_GE_OQ)), i, selection);
+    for (; i < n; i++)
+        if (values[i] >= threshold)
+            selection.push_back(i);
+}
+#endif
+
+static SelectionKernels selectKernels()
+{
+#if defined(KEYPOINT_STORE_AVX2)
+#if defined(KEYPOINT_STORE_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+#endif
+        return SelectionKernels{"AVX2", inRectAvx2, atLeastAvx2};
+#endif
+    return SelectionKernels{"scalar", inRectScalar, atLeastScalar};
+}
+
+static const SelectionKernels &selectionKernels()
+{
+    static const SelectionKernels kernels = selectKernels(); // once per process, thread safe
+    return kernels;
+}
+
+const char *KeypointStore::implementation()
+{
+    return selectionKernels().name;
+}
+
+void KeypointStore::clear()
+{
+    count = 0;
+    x.clear();
+    y.clear();
+    kptSize.clear();
+    angle.clear();
+    response.clear();
+    octave.clear();
+    classId.clear();
+}
+
+void KeypointStore::assign(const std::vector<cv::KeyPoint> &keypoints, int fields)
+{
+    clear();
+    count = keypoints.size();
+    if (fields & FIELD_POSITION)
+    {
+        x.resize(count);
+        y.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            x[i] = keypoints[i].pt.x;
+            y[i] = keypoints[i].pt.y;
+        }
+    }
+    if (fields & FIELD_RESPONSE)
+    {
+        response.resize(count);
+        for (size_t i = 0; i < count; i++)
+            response[i] = keypoints[i].response;
+    }
+    if (fields & FIELD_OTHER)
+    {
+        kptSize.resize(count);
+        angle.resize(count);
+        octave.resize(count);
+        classId.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            const cv::KeyPoint &kpt = keypoints[i];
+            kptSize[i] = kpt.size;
+            angle[i] = kpt.angle;
+            octave[i] = kpt.octave;
+            classId[i] = kpt.class_id;
+        }
+    }
+}
+
+void KeypointStore::push_back(const cv::KeyPoint &kpt)
+{
+    x.push_back(kpt.pt.x);
+    y.push_back(kpt.pt.y);
+    kptSize.push_back(kpt.size);
+    angle.push_back(kpt.angle);
+    response.push_back(kpt.response);
+    octave.push_back(kpt.octave);
+    classId.push_back(kpt.class_id);
+    count++;
+}
+
+cv::KeyPoint KeypointStore::at(size_t i) const
+{
+    return cv::KeyPoint(x[i], y[i], kptSize[i], angle[i], response[i], octave[i], classId[i]);
+}
+
+void KeypointStore::copyTo(std::vector<cv::KeyPoint> &keypoints) const
+{
+    keypoints.resize(count);
+    for (size_t i = 0; i < count; i++)
+        keypoints[i] = at(i);
+}
+
+void KeypointStore::selectInRect(const cv::Rect &rect, std::vector<int> &selection) const
+{
+    selection.clear();
+    selectionKernels().inRect(x.data(), y.data(), (int)x.size(), rect.x, rect.x + rect.width, rect.y, rect.y + rect.height,
+                              selection);
+}
+
+void KeypointStore::selectBest(int n, std::vector<int> &selection)
+{
+    selection.clear();
+    int total = (int)response.size();
+    if (n <= 0)
+        return;
+    if (n >= total)
+    {
+        for (int i = 0; i < total; i++)
+            selection.push_back(i);
+        return;
+    }
+
+    // response of the n-th best keypoint, and how many keypoints tied with it fit into the n
+    responseScratch.assign(response.begin(), response.end());
+    nth_element(responseScratch.begin(), responseScratch.begin() + (n - 1), responseScratch.end(), greater<float>());
+    float threshold = responseScratch[n - 1];
+    int ties = n - (int)count_if(responseScratch.begin(), responseScratch.begin() + (n - 1),
+                                 [threshold](float r) { return r > threshold; });
+
+    // candidates at or above the threshold in order, ties are kept until there are n
+    selectionKernels().atLeast(response.data(), total, threshold, selection);
+    size_t kept = 0;
+    for (auto it = selection.begin(); it != selection.end(); ++it)
+    {
+        if (response[*it] > threshold || ties-- > 0)
+            selection[kept++] = *it;
+    }
+    selection.resize(kept);
+}
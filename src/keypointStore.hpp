@@ -0,0 +1,97 @@
+#ifndef keypointStore_hpp
+#define keypointStore_hpp
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+
+// Allocator for 32 byte aligned arrays (one AVX2 register)
+template <typename T, size_t Alignment = 32>
+struct AlignedAllocator
+{
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+    AlignedAllocator() {}
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(size_t n)
+    {
+#if defined(_WIN32)
+        void *p = _aligned_malloc(n * sizeof(T), Alignment);
+        if (!p)
+            throw std::bad_alloc();
+#else
+        void *p = nullptr;
+        if (posix_memalign(&p, Alignment, n * sizeof(T)) != 0)
+            throw std::bad_alloc();
+#endif
+        return static_cast<T *>(p);
+    }
+
+    void deallocate(T *p, size_t)
+    {
+#if defined(_WIN32)
+        _aligned_free(p);
+#else
+        free(p);
+#endif
+    }
+};
+
+template <typename T, typename U, size_t A>
+bool operator==(const AlignedAllocator<T, A> &, const AlignedAllocator<U, A> &) { return true; }
+template <typename T, typename U, size_t A>
+bool operator!=(const AlignedAllocator<T, A> &, const AlignedAllocator<U, A> &) { return false; }
+
+// Keypoints as struct of arrays
+// Every cv::KeyPoint field lives in its own aligned array, so a pass over the positions or the responses only loads
+// those values (4 bytes per keypoint and field instead of the 28 byte struct). Selections return the indices of the
+// chosen keypoints in order, which also address the matching descriptor rows and match indices.
+class KeypointStore
+{
+public:
+    typedef std::vector<float, AlignedAllocator<float>> FloatArray;
+    typedef std::vector<int, AlignedAllocator<int>> IntArray;
+
+    enum Field { FIELD_POSITION = 1, FIELD_RESPONSE = 2, FIELD_OTHER = 4, FIELDS_ALL = 7 };
+
+    KeypointStore() : count(0) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear();
+
+    // fills the arrays of the given fields only, the others stay empty (a position test only needs x and y)
+    void assign(const std::vector<cv::KeyPoint> &keypoints, int fields = FIELDS_ALL);
+    void push_back(const cv::KeyPoint &kpt);
+    cv::KeyPoint at(size_t i) const;
+    void copyTo(std::vector<cv::KeyPoint> &keypoints) const;
+
+    // indices of the keypoints inside the rectangle, same test as cv::Rect::contains(kpt.pt), which rounds the
+    // position to integer pixels (needs FIELD_POSITION)
+    void selectInRect(const cv::Rect &rect, std::vector<int> &selection) const;
+
+    // indices of the n keypoints with the highest response in the original order, keypoints tied with the n-th one
+    // are taken in order until there are n (needs FIELD_RESPONSE)
+    void selectBest(int n, std::vector<int> &selection);
+
+    // name of the implementation selected at runtime from the CPU features
+    static const char *implementation();
+
+    FloatArray x, y, kptSize, angle, response; // kptSize: cv::KeyPoint::size
+    IntArray octave, classId;
+
+private:
+    size_t count;
+    std::vector<float> responseScratch;
+};
+
+#endif /* keypointStore_hpp */
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cmath>
+#include <opencv2/video/tracking.hpp>
+
+#include "kltTracker.hpp"
+#include "tracing.hpp"
+
+using namespace std;
+
+KltTracker::KltTracker(const KltConfig &config)
+    : cfg(config), winSize(config.winSize, config.winSize), bHasKeyframe(false), keyframeCount(0), trackCount(0), framesSinceKeyframe(0)
+{
+}
+
+bool KltTracker::needsKeyframe() const
+{
+    return !bHasKeyframe || trackCount < cfg.minTracks || trackCount < cfg.minTrackRatio * keyframeCount ||
+           framesSinceKeyframe >= cfg.maxFramesBetweenKeyframes;
+}
+
+void KltTracker::reset()
+{
+    bHasKeyframe = false;
+    keyframeCount = trackCount = framesSinceKeyframe = 0;
+}
+
+void KltTracker::buildPyramid(const cv::Mat &img, std::vector<cv::Mat> &pyramid) const
+{
+    TRACE_SCOPE("build LK pyramid");
+    cv::buildOpticalFlowPyramid(img, pyramid, winSize, cfg.maxLevel);
+}
+
+void KltTracker::setKeyframe(const DataFrame &frame)
+{
+    buildPyramid(frame.cameraImg, prevPyramid);
+    bHasKeyframe = true;
+    keyframeCount = trackCount = (int)frame.keypoints.size();
+    framesSinceKeyframe = 0;
+}
+
+double KltTracker::track(const DataFrame &prev, DataFrame &cur, const cv::Rect &roi)
+{
+    TRACE_SCOPE("KLT track");
+    double t = (double)cv::getTickCount();
+
+    buildPyramid(cur.cameraImg, curPyramid);
+
+    prevPts.clear();
+    for (auto it = prev.keypoints.begin(); it != prev.keypoints.end(); ++it)
+        prevPts.push_back((*it).pt);
+
+    cur.keypoints.clear();
+    cur.kptMatches.clear();
+    cur.kptMotion.clear();
+    if (!prevPts.empty())
+    {
+        cv::TermCriteria criteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, cfg.maxIterations, cfg.epsilon);
+        cv::calcOpticalFlowPyrLK(prevPyramid, curPyramid, prevPts, curPts, status, cv::noArray(), winSize, cfg.maxLevel, criteria);
+
+        // forward-backward check, a reliable track returns to its start point
+        bool bCheckBack = cfg.maxForwardBackwardError > 0;
+        if (bCheckBack)
+            cv::calcOpticalFlowPyrLK(curPyramid, prevPyramid, curPts, backPts, backStatus, cv::noArray(), winSize, cfg.maxLevel, criteria);
+
+        vector<int> kept; // indices into prev of the surviving tracks
+        for (size_t i = 0; i < prevPts.size(); i++)
+        {
+            if (!status[i] || !roi.contains(curPts[i]))
+                continue;
+            if (bCheckBack && (!backStatus[i] || hypot(backPts[i].x - prevPts[i].x, backPts[i].y - prevPts[i].y) > cfg.maxForwardBackwardError))
+                continue;
+
+            cv::KeyPoint kpt = prev.keypoints[i];
+            kpt.pt = curPts[i];
+            // the track keeps the descriptor, so the descriptor distance of the match is 0
+            cur.kptMatches.push_back(cv::DMatch((int)i, (int)cur.keypoints.size(), 0.0f));
+            cur.keypoints.push_back(kpt);
+            cur.kptMotion.push_back(curPts[i] - prevPts[i]);
+            kept.push_back((int)i);
+        }
+
+        // tracked keypoints keep their keyframe descriptors
+        cur.descriptors.create((int)kept.size(), prev.descriptors.cols, prev.descriptors.type());
+        for (size_t i = 0; i < kept.size() && !prev.descriptors.empty(); i++)
+        {
+            cv::Mat descRow = cur.descriptors.row((int)i);
+            prev.descriptors.row(kept[i]).copyTo(descRow);
+        }
+    }
+    else
+        cur.descriptors.create(0, prev.descriptors.cols, prev.descriptors.type());
+
+    swap(prevPyramid, curPyramid);
+    trackCount = (int)cur.keypoints.size();
+    framesSinceKeyframe++;
+
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
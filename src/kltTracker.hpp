@@ -0,0 +1,68 @@
+#ifndef kltTracker_hpp
+#define kltTracker_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+
+
+struct KltConfig {
+
+    int winSize = 21;               // search window per pyramid level [px]
+    int maxLevel = 3;               // pyramid levels above the full resolution image
+    int maxIterations = 30;         // termination criteria of the iterative search
+    double epsilon = 0.01;
+    double maxForwardBackwardError = 1.0; // [px] a track is dropped if tracking it back misses its start, <= 0: off
+
+    double minTrackRatio = 0.5;     // re-detect when less than this share of the keyframe keypoints is still tracked
+    int minTracks = 20;             // ... or less than this many tracks are left
+    int maxFramesBetweenKeyframes = 5; // ... or after this many tracked frames (descriptors are from the keyframe)
+};
+
+// Pyramidal Lucas-Kanade tracking of keypoints between keyframes
+// Keyframes run the regular detection, description and matching. On the frames in between, the keypoints of the
+// previous frame are tracked with optical flow instead. Every surviving track becomes a keypoint of the new frame
+// and keeps the descriptor from its keyframe. kptMatches is written the same way matching does: queryIdx indexes
+// the previous frame, trainIdx the current one, and the distance is the descriptor distance (always 0, as the track
+// keeps its descriptor). The image pyramid of every frame is built once and reused as the previous pyramid for the
+// next frame.
+class KltTracker
+{
+public:
+    explicit KltTracker(const KltConfig &config = KltConfig());
+
+    // true if the next frame has to be a keyframe (no keyframe yet, too few or too old tracks)
+    bool needsKeyframe() const;
+
+    // register a detected frame as keyframe, its image becomes the reference for the next track() call
+    void setKeyframe(const DataFrame &frame);
+
+    // track the keypoints of prev (the last frame passed to setKeyframe or track) into cur, tracks leaving roi are
+    // dropped; fills keypoints, descriptors and kptMatches of cur, returns the processing time in ms
+    double track(const DataFrame &prev, DataFrame &cur, const cv::Rect &roi);
+
+    // forget the keyframe, e.g. when a new sequence starts
+    void reset();
+
+    int trackedCount() const { return trackCount; }
+
+private:
+    void buildPyramid(const cv::Mat &img, std::vector<cv::Mat> &pyramid) const;
+
+    KltConfig cfg;
+    cv::Size winSize;
+
+    bool bHasKeyframe;
+    int keyframeCount;   // keypoints of the last keyframe
+    int trackCount;      // keypoints of the last tracked frame
+    int framesSinceKeyframe;
+
+    // scratch buffers, reused between frames
+    std::vector<cv::Mat> prevPyramid, curPyramid;
+    std::vector<cv::Point2f> prevPts, curPts, backPts;
+    std::vector<uchar> status, backStatus;
+};
+
+#endif /* kltTracker_hpp */
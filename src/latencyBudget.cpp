@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "latencyBudget.hpp"
+
+using namespace std;
+
+LatencyBudgetController::LatencyBudgetController(const LatencyBudgetConfig &config, double threshold, double minThreshold, double maxThreshold)
+    : cfg(config), minThreshold(minThreshold), maxThreshold(maxThreshold)
+{
+    reset(threshold);
+}
+
+void LatencyBudgetController::reset(double threshold)
+{
+    currentThreshold = min(maxThreshold, max(minThreshold, threshold));
+    bHasHistory = false;
+    bHasTrackHistory = false;
+    bDroppedLast = false;
+    lastDetectionTime = 0.0;
+    descriptionTimePerKpt = 0.0;
+    lastKeypoints = 0;
+    lastTrackingTime = 0.0;
+}
+
+bool LatencyBudgetController::shouldDrop(bool bKeyframe)
+{
+    if (!(bKeyframe ? bHasHistory : bHasTrackHistory) || bDroppedLast)
+    {
+        bDroppedLast = false;
+        return false;
+    }
+
+    // the threshold was raised after a slow frame, so this over- rather than underestimates the next frame
+    double predicted = bKeyframe ? lastDetectionTime + descriptionTimePerKpt * lastKeypoints : lastTrackingTime;
+    bDroppedLast = predicted > cfg.dropFactor * cfg.frameBudget;
+    return bDroppedLast;
+}
+
+int LatencyBudgetController::keypointLimit(double detectionTime) const
+{
+    if (!bHasHistory || descriptionTimePerKpt <= 0.0)
+        return -1;
+
+    // a frame cut to (almost) no keypoints can not be matched, a slow detection is corrected by the threshold instead
+    double remaining = max(0.0, cfg.frameBudget - detectionTime);
+    return max(cfg.minKeypoints, (int)min(remaining / descriptionTimePerKpt, (double)INT_MAX));
+}
+
+void LatencyBudgetController::update(int keypointsDetected, int keypointsDescribed, double detectionTime, double descriptionTime)
+{
+    // exponential smoothing, single frames with few keypoints give noisy per keypoint costs
+    if (keypointsDescribed > 0)
+    {
+        double perKpt = descriptionTime / keypointsDescribed;
+        descriptionTimePerKpt = bHasHistory && descriptionTimePerKpt > 0.0 ? 0.7 * descriptionTimePerKpt + 0.3 * perKpt : perKpt;
+    }
+    lastDetectionTime = detectionTime;
+    lastKeypoints = keypointsDetected;
+    bHasHistory = true;
+
+    // more keypoints than the target or a missed deadline raise the threshold, both factors are damped by the gain
+    double scale = pow(max(1, keypointsDetected) / (double)max(1, cfg.targetKeypoints), cfg.gain);
+    double frameTime = detectionTime + descriptionTime;
+    if (frameTime > cfg.frameBudget)
+        scale *= pow(frameTime / cfg.frameBudget, cfg.gain);
+
+    currentThreshold = min(maxThreshold, max(minThreshold, currentThreshold * scale));
+}
+
+void LatencyBudgetController::updateTracked(double trackingTime)
+{
+    lastTrackingTime = trackingTime;
+    bHasTrackHistory = true;
+
+    // the tracks stem from the keyframe detection, fewer keypoints there also make tracking faster
+    if (trackingTime > cfg.frameBudget)
+        currentThreshold = min(maxThreshold, max(minThreshold, currentThreshold * pow(trackingTime / cfg.frameBudget, cfg.gain)));
+}
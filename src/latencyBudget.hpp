@@ -0,0 +1,57 @@
+#ifndef latencyBudget_hpp
+#define latencyBudget_hpp
+
+
+struct LatencyBudgetConfig {
+
+    double frameBudget = 30.0;  // [ms] detection + description deadline per frame
+    int targetKeypoints = 150;  // keypoints per frame the threshold controller aims for
+    double gain = 0.5;          // exponent of the multiplicative threshold update, 1: full correction in one frame
+    double dropFactor = 2.0;    // drop a frame if its predicted time exceeds the budget by this factor
+    int minKeypoints = 20;      // always described, even if detection alone used up the budget
+};
+
+// Real-time controller for one detector/descriptor pipeline
+// After every frame the detector threshold is scaled by (keypoints / target)^gain, and additionally by
+// (time / budget)^gain if the frame was too slow, so keypoint count and latency settle near their targets. The cost
+// of the next frame is predicted from the last detection time and the description time per keypoint: a frame which
+// would exceed the budget by dropFactor is dropped, otherwise the keypoints are cut to what the remaining budget can
+// describe. Two frames in a row are never dropped, the frame after a drop measures the retuned threshold. Frames
+// tracked between keyframes are predicted from the last tracking time, a slow one only raises the threshold.
+class LatencyBudgetController
+{
+public:
+    LatencyBudgetController(const LatencyBudgetConfig &config, double threshold, double minThreshold, double maxThreshold);
+
+    double threshold() const { return currentThreshold; }
+
+    // before detection (or tracking, bKeyframe false): skip this frame
+    bool shouldDrop(bool bKeyframe = true);
+
+    // after detection: number of keypoints which can be described within the budget (at least minKeypoints), -1 if
+    // there is no limit
+    int keypointLimit(double detectionTime) const;
+
+    // after the frame: retune the threshold from the detected keypoints and the measured times, the description
+    // cost per keypoint is estimated from the keypoints actually described (after keypointLimit)
+    void update(int keypointsDetected, int keypointsDescribed, double detectionTime, double descriptionTime);
+
+    // after a tracked frame, which has no detection or description
+    void updateTracked(double trackingTime);
+
+    void reset(double threshold);
+
+private:
+    LatencyBudgetConfig cfg;
+    double currentThreshold, minThreshold, maxThreshold;
+
+    bool bHasHistory;
+    bool bHasTrackHistory;
+    bool bDroppedLast;
+    double lastDetectionTime;      // [ms]
+    double descriptionTimePerKpt; // [ms], smoothed
+    int lastKeypoints;             // detected
+    double lastTrackingTime;       // [ms]
+};
+
+#endif /* latencyBudget_hpp */
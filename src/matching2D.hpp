@@ -19,11 +19,19 @@
 #include "dataStructures.h"
 
 
-double detKeypointsHarris(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis=false);
-double detKeypointsShiTomasi(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis=false);
-double detKeypointsModern(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, std::string detectorType, bool bVis=false);
+// Free-function interface, thin wrappers around FeaturePipeline (see featurePipeline.hpp)
+double detKeypointsHarris(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, bool bVis=false);
+double detKeypointsShiTomasi(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, bool bVis=false);
+double detKeypointsModern(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, std::string detectorType, bool bVis=false);
 
-double descKeypoints(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, cv::Mat &descriptors, std::string descriptorType);
+double descKeypoints(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, cv::Mat &descriptors, std::string descriptorType);
+
+// ROI restricted versions, only the rectangles (plus border) are processed, keypoints are in full image coordinates
+double detKeypointsHarris(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois, bool bVis=false);
+double detKeypointsShiTomasi(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois, bool bVis=false);
+double detKeypointsModern(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois, std::string detectorType, bool bVis=false);
+
+double descKeypoints(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const std::vector<cv::Rect> &rois, cv::Mat &descriptors, std::string descriptorType);
 
 void matchDescriptors(std::vector<cv::KeyPoint> &kPtsSource, std::vector<cv::KeyPoint> &kPtsRef, cv::Mat &descSource, cv::Mat &descRef,
                       std::vector<cv::DMatch> &matches, std::string descriptorType, std::string matcherType, std::string selectorType);
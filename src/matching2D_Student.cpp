@@ -1,282 +1,107 @@
+#include <map>
+#include <memory>
+#include <tuple>
 #include <numeric>
 #include "matching2D.hpp"
+#include "featurePipeline.hpp"
 
 using namespace std;
 
+// The free functions are thin wrappers around FeaturePipeline. Each thread keeps one pipeline per configuration,
+// so detectors, extractors and matchers are only created on the first call.
+static FeaturePipeline &cachedPipeline(const PipelineConfig &config)
+{
+    typedef tuple<int, int, int, int, int, bool> ConfigKey;
+    static thread_local map<ConfigKey, unique_ptr<FeaturePipeline>> pipelines;
+
+    ConfigKey key((int)config.detectorType, (int)config.descriptorType, (int)config.descriptorFamily,
+                  (int)config.matcherType, (int)config.selectorType, config.bQuantizeDescriptors);
+    unique_ptr<FeaturePipeline> &pipeline = pipelines[key];
+    if (!pipeline)
+        pipeline.reset(new FeaturePipeline(config));
+    return *pipeline;
+}
+
 // Find best matches for keypoints in two camera images based on several matching methods
 void matchDescriptors(std::vector<cv::KeyPoint> &kPtsSource, std::vector<cv::KeyPoint> &kPtsRef, cv::Mat &descSource, cv::Mat &descRef,
                       std::vector<cv::DMatch> &matches, std::string descriptorType, std::string matcherType, std::string selectorType)
 {
-    // configure matcher
-    bool crossCheck = false;
-    cv::Ptr<cv::DescriptorMatcher> matcher;
-
-    if (matcherType.compare("MAT_BF") == 0) // brute force matching
-    {
-        int normType;
-        if(descriptorType.compare("DES_BINARY") == 0)
-            normType = cv::NORM_HAMMING;
-        else // DES_HOG
-            normType = cv::NORM_L2;
-
-        matcher = cv::BFMatcher::create(normType, crossCheck);
-    }
-
-    else if (matcherType.compare("MAT_FLANN") == 0)
-    {
-        if (descSource.type() != CV_32F)
-        { // OpenCV bug workaround : convert binary descriptors to floating point due to a bug in current OpenCV implementation
-            descSource.convertTo(descSource, CV_32F);
-            descRef.convertTo(descRef, CV_32F);
-        }
-        matcher = cv::DescriptorMatcher::create(cv::DescriptorMatcher::FLANNBASED);
-    }
-
-    // ### perform matching
-    if (selectorType.compare("SEL_NN") == 0) // nearest neighbor (best match)
-    {
-        matcher->match(descSource, descRef, matches); // Finds the best match for each descriptor in desc1
-    }
-
-    else if (selectorType.compare("SEL_KNN") == 0) // k nearest neighbors (k = 2)
-    {
-        vector<vector<cv::DMatch>> knn_matches;
-
-        matcher->knnMatch(descSource, descRef, knn_matches, 2); // finds the 2 best matches
-        //cout << " (KNN) with n=" << knn_matches.size() << " matches." << endl;
-
-        // ### filter matches using descriptor distance ratio test
-        double minDescDistRatio = 0.8;
-
-        for (auto it = knn_matches.begin(); it != knn_matches.end(); ++it)
-            if ((*it)[0].distance < minDescDistRatio * (*it)[1].distance)
-                matches.push_back((*it)[0]);
-
-        //cout << "# keypoints removed = " << knn_matches.size() - matches.size() << endl;
-    }
+    PipelineConfig config;
+    config.descriptorFamily = descriptorFamilyFromString(descriptorType);
+    config.matcherType = matcherTypeFromString(matcherType);
+    config.selectorType = selectorTypeFromString(selectorType);
+    // 8-bit gradient histograms come from quantizeDescriptors, MAT_SIMD matches them with integer L2
+    config.bQuantizeDescriptors = config.descriptorFamily == DescriptorFamily::DES_HOG && descSource.depth() == CV_8U;
+
+    cachedPipeline(config).match(descSource, descRef, matches);
 }
 
 // Use one of several types of state-of-art descriptors to uniquely identify keypoints
-double descKeypoints(vector<cv::KeyPoint> &keypoints, cv::Mat &img, cv::Mat &descriptors, string descriptorType)
+double descKeypoints(vector<cv::KeyPoint> &keypoints, const cv::Mat &img, cv::Mat &descriptors, string descriptorType)
 {
-    // select appropriate descriptor
-    cv::Ptr<cv::DescriptorExtractor> extractor;
-    if (descriptorType.compare("BRISK") == 0)
-    {
-        int threshold = 30;        // FAST/AGAST detection threshold score.
-        int octaves = 3;           // detection octaves (use 0 to do single scale)
-        float patternScale = 1.0f; // apply this scale to the pattern used for sampling the neighbourhood of a keypoint.
-
-        extractor = cv::BRISK::create(threshold, octaves, patternScale);
-    }
-
-    else if(descriptorType.compare("BRIEF") == 0)
-    {
-        extractor = cv::xfeatures2d::BriefDescriptorExtractor::create();
-    }
-
-    else if(descriptorType.compare("ORB") == 0)
-    {
-        extractor = cv::ORB::create();
-    }
+    PipelineConfig config;
+    config.descriptorType = descriptorTypeFromString(descriptorType);
 
-    else if(descriptorType.compare("FREAK") == 0)
-    {
-        extractor = cv::xfeatures2d::FREAK::create();
-    }
-
-    else if(descriptorType.compare("AKAZE") == 0)
-    {
-        extractor = cv::AKAZE::create();
-    }
-
-    else if(descriptorType.compare("SIFT") == 0)
-    {
-        extractor = cv::xfeatures2d::SIFT::create();
-    }
-
-    // perform feature description
-    double t = (double)cv::getTickCount();
-    extractor->compute(img, keypoints, descriptors);
-    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
-    //cout << descriptorType << " descriptor extraction in " << t << " ms" << endl;
-
-    return t;
+    return cachedPipeline(config).describe(keypoints, img, descriptors);
 }
 
 // Detect keypoints in image using the traditional Shi-Thomasi detector
-double detKeypointsShiTomasi(vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
+double detKeypointsShiTomasi(vector<cv::KeyPoint> &keypoints, const cv::Mat &img, bool bVis)
 {
-    // compute detector parameters based on image size
-    int blockSize = 4;       //  size of an average block for computing a derivative covariation matrix over each pixel neighborhood
-    double maxOverlap = 0.0; // max. permissible overlap between two features in %
-    double minDistance = (1.0 - maxOverlap) * blockSize;
-    int maxCorners = img.rows * img.cols / max(1.0, minDistance); // max. num. of keypoints
-
-    double qualityLevel = 0.01; // minimal accepted quality of image corners
-    double k = 0.04;
+    PipelineConfig config;
+    config.detectorType = DetectorType::SHITOMASI;
 
-    // Apply corner detection
-    double t = (double)cv::getTickCount();
-    vector<cv::Point2f> corners;
-    cv::goodFeaturesToTrack(img, corners, maxCorners, qualityLevel, minDistance, cv::Mat(), blockSize, false, k);
-
-    // add corners to result vector
-    for (auto it = corners.begin(); it != corners.end(); ++it)
-    {
-        cv::KeyPoint newKeyPoint;
-        newKeyPoint.pt = cv::Point2f((*it).x, (*it).y);
-        newKeyPoint.size = blockSize;
-        keypoints.push_back(newKeyPoint);
-    }
-
-    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
-    //cout << "SHITOMASI detection with n= " << keypoints.size() << " keypoints in " << t << " ms" << endl;
-
-    // visualize results
-    if (bVis)
-    {
-        cv::Mat visImage = img.clone();
-        cv::drawKeypoints(img, keypoints, visImage, cv::Scalar::all(-1), cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
-        string windowName = "Shi-Tomasi Corner Detector Results";
-        cv::namedWindow(windowName, 6);
-        imshow(windowName, visImage);
-        cv::waitKey(0);
-    }
-    return t;
+    return cachedPipeline(config).detect(keypoints, img, bVis);
 }
 
-double detKeypointsHarris(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, bool bVis)
+// Detect keypoints in image using the Harris detector with non-maximum suppression
+double detKeypointsHarris(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, bool bVis)
 {
-    // Detector parameters
-    int blockSize = 2;     // for every pixel, a blockSize × blockSize neighborhood is considered
-    int apertureSize = 3;  // aperture parameter for Sobel operator (must be odd)
-    int minResponse = 100; // minimum value for a corner in the 8bit scaled response matrix
-    double k = 0.04;       // Harris parameter (see equation for details)
-
-    // Detect Harris corners and normalize output
-    double t = (double)cv::getTickCount(); // timer begin
-
-    cv::Mat dst, dst_norm, dst_norm_scaled;
-    dst = cv::Mat::zeros(img.size(), CV_32FC1);
-    cv::cornerHarris(img, dst, blockSize, apertureSize, k, cv::BORDER_DEFAULT);
-    cv::normalize(dst, dst_norm, 0, 255, cv::NORM_MINMAX, CV_32FC1, cv::Mat());
-    cv::convertScaleAbs(dst_norm, dst_norm_scaled);
-
-    // Look for prominent corners and instantiate keypoints
-    double maxOverlap = 0.0; // max. permissible overlap between two features in %, used during non-maxima suppression
-    for (size_t j = 0; j < dst_norm.rows; j++)
-    {
-        for (size_t i = 0; i < dst_norm.cols; i++)
-        {
-            int response = (int)dst_norm.at<float>(j, i);
-            if (response > minResponse)
-            { // only store points above a threshold
-
-                cv::KeyPoint newKeyPoint;
-                newKeyPoint.pt = cv::Point2f(i, j);
-                newKeyPoint.size = 2 * apertureSize;
-                newKeyPoint.response = response;
-
-                // perform non-maximum suppression (NMS) in local neighbourhood around new key point
-                bool bOverlap = false;
-                for (auto it = keypoints.begin(); it != keypoints.end(); ++it)
-                {
-                    double kptOverlap = cv::KeyPoint::overlap(newKeyPoint, *it);
-                    if (kptOverlap > maxOverlap)
-                    {
-                        bOverlap = true;
-                        if (newKeyPoint.response > (*it).response)
-                        {                      // if overlap is >t AND response is higher for new kpt
-                            *it = newKeyPoint; // replace old key point with new one
-                            break;             // quit loop over keypoints
-                        }
-                    }
-                }
-                if (!bOverlap)
-                {                                     // only add new key point if no overlap has been found in previous NMS
-                    keypoints.push_back(newKeyPoint); // store new keypoint in dynamic list
-                }
-            }
-        } // eof loop over cols
-    }     // eof loop over rows
-
-    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
-    //cout << "HARRIS detection with n= " << keypoints.size() << " keypoints in " << t << " ms" << endl;
-
-    // visualize results
-    if (bVis)
-    {
-        cv::Mat visImage = img.clone();
-        cv::drawKeypoints(img, keypoints, visImage, cv::Scalar::all(-1), cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
-        string windowName = "Harris Corner Detector Results";
-        cv::namedWindow(windowName, 6);
-        imshow(windowName, visImage);
-        cv::waitKey(0);
-    }
+    PipelineConfig config;
+    config.detectorType = DetectorType::HARRIS;
 
-    return t;
+    return cachedPipeline(config).detect(keypoints, img, bVis);
 }
 
-
-double detKeypointsModern(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, std::string detectorType, bool bVis)
+// Several modern (2006-2012) OpenCV feature/keypoint detector methods: FAST, BRISK, ORB, AKAZE, SIFT
+double detKeypointsModern(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, std::string detectorType, bool bVis)
 {
-    // Several modern (2006-2012) OpenCV feature/keypoint detector methods
-    // See https://docs.opencv.org/master/d0/d13/classcv_1_1Feature2D.html
-    // (!) SIFT and SURF are patented and not freely available for commercial applications
+    PipelineConfig config;
+    config.detectorType = detectorTypeFromString(detectorType);
 
-    cv::Ptr<cv::FeatureDetector> detector;
-    string windowName;
+    return cachedPipeline(config).detect(keypoints, img, bVis);
+}
 
-    if(detectorType.compare("FAST") == 0) // FAST feature detector
-    {
-        int threshold = 30; // difference between intensity of the central pixel and pixels of a circle around this pixel
-        bool bNMS = true; // perform non-maxima suppression on keypoints
-        cv::FastFeatureDetector::DetectorType type = cv::FastFeatureDetector::TYPE_9_16; // TYPE_9_16, TYPE_7_12, TYPE_5_8
-        detector = cv::FastFeatureDetector::create(threshold, bNMS, type);
-        windowName = "FAST Detector Results";
-    }
+// #### ROI restricted versions ####
 
-    else if(detectorType.compare("BRISK") == 0) // BRISK
-    {
-        detector = cv::BRISK::create();
-        windowName = "BRISK Detector Results";
-    }
+double descKeypoints(vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const vector<cv::Rect> &rois, cv::Mat &descriptors, string descriptorType)
+{
+    PipelineConfig config;
+    config.descriptorType = descriptorTypeFromString(descriptorType);
 
-    else if(detectorType.compare("ORB") == 0) // ORB
-    {
-        detector = cv::ORB::create();
-        windowName = "ORB Detector Results";
-    }
+    return cachedPipeline(config).describe(keypoints, img, rois, descriptors);
+}
 
-    else if(detectorType.compare("AKAZE") == 0) // AKAZE
-    {
-        detector = cv::AKAZE::create();
-        windowName = "AKAZE Detector Results";
-    }
+double detKeypointsShiTomasi(vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const vector<cv::Rect> &rois, bool bVis)
+{
+    PipelineConfig config;
+    config.detectorType = DetectorType::SHITOMASI;
 
-    else if(detectorType.compare("SIFT") == 0) // SIFT
-    {
-        detector = cv::xfeatures2d::SIFT::create();
-        windowName = "SIFT Detector Results";
-    }
+    return cachedPipeline(config).detect(keypoints, img, rois, bVis);
+}
 
-    // detect keypoints
-    double t = (double)cv::getTickCount();
-    detector->detect(img, keypoints);
-    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
-    //cout << detectorType << " detection with n= " << keypoints.size() << " keypoints in " << t << " ms" << endl;
+double detKeypointsHarris(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const vector<cv::Rect> &rois, bool bVis)
+{
+    PipelineConfig config;
+    config.detectorType = DetectorType::HARRIS;
 
-    // visualize keypoints
-    if (bVis)
-    {
-        cv::Mat visImage = img.clone();
-        cv::drawKeypoints(img, keypoints, visImage, cv::Scalar::all(-1), cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
-        cv::namedWindow(windowName, 6);
-        imshow(windowName, visImage);
-        cv::waitKey(0);
-    }
+    return cachedPipeline(config).detect(keypoints, img, rois, bVis);
+}
 
-    return t;
+double detKeypointsModern(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const vector<cv::Rect> &rois, std::string detectorType, bool bVis)
+{
+    PipelineConfig config;
+    config.detectorType = detectorTypeFromString(detectorType);
 
+    return cachedPipeline(config).detect(keypoints, img, rois, bVis);
 }
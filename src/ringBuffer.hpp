@@ -0,0 +1,59 @@
+#ifndef ringBuffer_hpp
+#define ringBuffer_hpp
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+// Fixed capacity ring buffer which reuses its slots in place
+// All slots are constructed once, pushSlot() hands out the oldest slot when the buffer is full instead of erasing
+// it, so members like vectors keep their capacity from frame to frame. Element 0 is the oldest, size() - 1 the newest.
+template <typename T>
+class RingBuffer
+{
+public:
+    explicit RingBuffer(size_t capacity) : slots(capacity > 0 ? capacity : 1), first(0), count(0) {}
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    // slot for a new newest element, still holds the contents of the element it replaces
+    T &pushSlot()
+    {
+        if (count < slots.size())
+            return slots[index(count++)];
+
+        T &slot = slots[first]; // overwrite the oldest element
+        first = index(1);
+        return slot;
+    }
+
+    void push(T &&item) { pushSlot() = std::move(item); }
+
+    T &operator[](size_t i) { return slots[index(i)]; }
+    const T &operator[](size_t i) const { return slots[index(i)]; }
+
+    T &back() { return slots[index(count - 1)]; }
+    const T &back() const { return slots[index(count - 1)]; }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return slots.size(); }
+    bool full() const { return count == slots.size(); }
+
+    // forget all elements, the slots keep their contents for reuse
+    void clear()
+    {
+        first = 0;
+        count = 0;
+    }
+
+private:
+    size_t index(size_t i) const { return (first + i) % slots.size(); }
+
+    std::vector<T> slots;
+    size_t first; // slot of the oldest element
+    size_t count;
+};
+
+#endif /* ringBuffer_hpp */
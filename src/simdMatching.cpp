@@ -0,0 +1,459 @@
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+// the AVX2 / AVX-512 kernels are compiled with target attributes and selected from the CPU features at runtime,
+// so they are used without -march=native
+#define SIMD_RUNTIME_DISPATCH
+#define HAMMING_AVX512
+#define HAMMING_AVX2
+#define L2_AVX512
+#define L2_AVX2
+#define TARGET_HAMMING_AVX512 __attribute__((target("avx512f,avx512bw,avx512vpopcntdq")))
+#define TARGET_L2_AVX512 __attribute__((target("avx512f,avx512bw")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#else
+// other compilers only build the kernels they target
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VPOPCNTDQ__)
+#define HAMMING_AVX512
+#endif
+#if defined(__AVX512BW__)
+#define L2_AVX512
+#endif
+#if defined(__AVX2__)
+#define HAMMING_AVX2
+#define L2_AVX2
+#endif
+#if defined(HAMMING_AVX512) || defined(L2_AVX512) || defined(L2_AVX2)
+#include <immintrin.h>
+#endif
+#define TARGET_HAMMING_AVX512
+#define TARGET_L2_AVX512
+#define TARGET_AVX2
+#endif
+
+#include "simdMatching.hpp"
+
+using namespace std;
+
+// distance kernel of one instruction set: distance of two descriptors and of one query to every reference row
+struct DistanceKernels {
+    const char *name;
+    int (*distance)(const uchar *a, const uchar *b, int bytes);
+    void (*distanceRow)(const uchar *query, const cv::Mat &descRef, int *dists);
+};
+
+// true if the CPU runs kernels of the given feature set, without runtime dispatch only compiled kernels exist
+static bool cpuSupports(const char *feature)
+{
+#if defined(SIMD_RUNTIME_DISPATCH)
+    __builtin_cpu_init();
+    if (strcmp(feature, "avx512-hamming") == 0)
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vpopcntdq");
+    if (strcmp(feature, "avx512-l2") == 0)
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    return __builtin_cpu_supports("avx2");
+#else
+    (void)feature;
+    return true;
+#endif
+}
+
+static inline int popcount64(uint64_t x)
+{
+#if defined(_MSC_VER)
+    return (int)__popcnt64(x);
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+// scalar popcount of the bytes from i on
+static inline int hammingTail(const uchar *a, const uchar *b, int i, int bytes)
+{
+    int dist = 0;
+    for (; i + 8 <= bytes; i += 8)
+    {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        dist += popcount64(x ^ y);
+    }
+    for (; i < bytes; i++)
+        dist += popcount64((uint64_t)(a[i] ^ b[i]));
+    return dist;
+}
+
+static int hammingScalar(const uchar *a, const uchar *b, int bytes)
+{
+    return hammingTail(a, b, 0, bytes);
+}
+
+#if defined(HAMMING_AVX512)
+TARGET_HAMMING_AVX512 static inline int hammingAvx512(const uchar *a, const uchar *b, int bytes)
+{
+    // 64 bytes per step, the tail (e.g. 61 byte AKAZE descriptors) is handled with a masked load
+    int i = 0;
+    __m512i acc = _mm512_setzero_si512();
+    for (; i + 64 <= bytes; i += 64)
+    {
+        __m512i x = _mm512_xor_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+    }
+    if (i < bytes)
+    {
+        __mmask64 mask = (__mmask64)((~0ULL) >> (64 - (bytes - i)));
+        __m512i x = _mm512_xor_si512(_mm512_maskz_loadu_epi8(mask, a + i), _mm512_maskz_loadu_epi8(mask, b + i));
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+    }
+    return (int)_mm512_reduce_add_epi64(acc);
+}
+#endif
+
+#if defined(HAMMING_AVX2)
+TARGET_AVX2 static inline int hammingAvx2(const uchar *a, const uchar *b, int bytes)
+{
+    // 32 bytes per step, nibble lookup popcount, byte counts summed with SAD
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowMask = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    __m256i acc = zero;
+    for (; i + 32 <= bytes; i += 32)
+    {
+        __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i)));
+        __m256i lo = _mm256_and_si256(x, lowMask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), lowMask);
+        __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, zero));
+    }
+    int dist = (int)(_mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3));
+    return dist + hammingTail(a, b, i, bytes);
+}
+#endif
+
+// the row loops carry the target of their kernel, so the kernel is inlined and only the row call is indirect
+static void hammingRowScalar(const uchar *query, const cv::Mat &descRef, int *dists)
+{
+    for (int r = 0; r < descRef.rows; r++)
+        dists[r] = hammingScalar(query, descRef.ptr<uchar>(r), descRef.cols);
+}
+
+#if defined(HAMMING_AVX512)
+TARGET_HAMMING_AVX512 static int hammingDistanceAvx512(const uchar *a, const uchar *b, int bytes)
+{
+    return hammingAvx512(a, b, bytes);
+}
+
+TARGET_HAMMING_AVX512 static void hammingRowAvx512(const uchar *query, const cv::Mat &descRef, int *dists)
+{
+    for (int r = 0; r < descRef.rows; r++)
+        dists[r] = hammingAvx512(query, descRef.ptr<uchar>(r), descRef.cols);
+}
+#endif
+
+#if defined(HAMMING_AVX2)
+TARGET_AVX2 static int hammingDistanceAvx2(const uchar *a, const uchar *b, int bytes)
+{
+    return hammingAvx2(a, b, bytes);
+}
+
+TARGET_AVX2 static void hammingRowAvx2(const uchar *query, const cv::Mat &descRef, int *dists)
+{
+    for (int r = 0; r < descRef.rows; r++)
+        dists[r] = hammingAvx2(query, descRef.ptr<uchar>(r), descRef.cols);
+}
+#endif
+
+static DistanceKernels selectHammingKernels()
+{
+#if defined(HAMMING_AVX512)
+    if (cpuSupports("avx512-hamming"))
+        return DistanceKernels{"AVX-512 VPOPCNTDQ", hammingDistanceAvx512, hammingRowAvx512};
+#endif
+#if defined(HAMMING_AVX2)
+    if (cpuSupports("avx2"))
+        return DistanceKernels{"AVX2", hammingDistanceAvx2, hammingRowAvx2};
+#endif
+    return DistanceKernels{"scalar popcount", hammingScalar, hammingRowScalar};
+}
+
+static const DistanceKernels &hammingKernels()
+{
+    static const DistanceKernels kernels = selectHammingKernels(); // once per process, thread safe
+    return kernels;
+}
+
+const char *hammingImplementation()
+{
+    return hammingKernels().name;
+}
+
+int hammingDistance(const uchar *a, const uchar *b, int bytes)
+{
+    return hammingKernels().distance(a, b, bytes);
+}
+
+// distances of every source row to all reference rows are computed row by row into a buffer reused by the thread
+static int *distanceBuffer(int rows)
+{
+    static thread_local vector<int> dists;
+    if ((int)dists.size() < rows)
+        dists.resize(rows);
+    return dists.data();
+}
+
+void matchHammingNN(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<cv::DMatch> &matches)
+{
+    if (descSource.empty() || descRef.empty()) // a frame without keypoints has a 0x0 descriptor matrix
+        return;
+    CV_Assert(descSource.depth() == CV_8U && descRef.depth() == CV_8U && descSource.cols == descRef.cols);
+
+    const DistanceKernels &kernels = hammingKernels();
+    int *dists = distanceBuffer(descRef.rows);
+    matches.reserve(matches.size() + descSource.rows);
+    for (int q = 0; q < descSource.rows; q++)
+    {
+        kernels.distanceRow(descSource.ptr<uchar>(q), descRef, dists);
+        int best = INT_MAX, bestIdx = -1;
+        for (int r = 0; r < descRef.rows; r++)
+        {
+            int dist = dists[r];
+            if (dist < best)
+            {
+                best = dist;
+                bestIdx = r;
+            }
+        }
+        matches.push_back(cv::DMatch(q, bestIdx, (float)best));
+    }
+}
+
+void matchHammingKnnRatio(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<cv::DMatch> &matches,
+                          double minDescDistRatio)
+{
+    if (descSource.empty() || descRef.rows < 2) // ratio test needs a second best match
+        return;
+    CV_Assert(descSource.depth() == CV_8U && descRef.depth() == CV_8U && descSource.cols == descRef.cols);
+
+    const DistanceKernels &kernels = hammingKernels();
+    int *dists = distanceBuffer(descRef.rows);
+    for (int q = 0; q < descSource.rows; q++)
+    {
+        kernels.distanceRow(descSource.ptr<uchar>(q), descRef, dists);
+
+        // keep the two best distances, ties keep the lower reference index first (same order as cv::BFMatcher)
+        int best = INT_MAX, second = INT_MAX, bestIdx = -1;
+        for (int r = 0; r < descRef.rows; r++)
+        {
+            int dist = dists[r];
+            if (dist < best)
+            {
+                second = best;
+                best = dist;
+                bestIdx = r;
+            }
+            else if (dist < second)
+                second = dist;
+        }
+
+        // descriptor distance ratio test
+        if (best < minDescDistRatio * second)
+            matches.push_back(cv::DMatch(q, bestIdx, (float)best));
+    }
+}
+
+
+// #### Quantized gradient descriptors ####
+
+void quantizeDescriptors(const cv::Mat &descriptors, cv::Mat &quantized, double scale)
+{
+    CV_Assert(descriptors.depth() == CV_32F || descriptors.depth() == CV_8U);
+    if (descriptors.depth() == CV_8U)
+    {
+        quantized = descriptors;
+        return;
+    }
+    descriptors.convertTo(quantized, CV_8U, scale); // rounds and saturates
+}
+
+// scalar squared L2 of the bytes from i on
+static inline int l2Tail(const uchar *a, const uchar *b, int i, int bytes)
+{
+    int dist = 0;
+    for (; i < bytes; i++)
+    {
+        int d = (int)a[i] - (int)b[i];
+        dist += d * d;
+    }
+    return dist;
+}
+
+// max. 255^2 per byte, a 128 byte SIFT descriptor stays far below the 32-bit range
+static int l2Scalar(const uchar *a, const uchar *b, int bytes)
+{
+    return l2Tail(a, b, 0, bytes);
+}
+
+#if defined(L2_AVX512)
+TARGET_L2_AVX512 static inline int l2Avx512(const uchar *a, const uchar *b, int bytes)
+{
+    // 32 bytes per step widened to 16-bit, differences squared and pairwise summed to 32-bit with madd
+    int i = 0;
+    __m512i acc = _mm512_setzero_si512();
+    for (; i + 32 <= bytes; i += 32)
+    {
+        __m512i x = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(a + i)));
+        __m512i y = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(b + i)));
+        __m512i d = _mm512_sub_epi16(x, y);
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(d, d));
+    }
+    return _mm512_reduce_add_epi32(acc) + l2Tail(a, b, i, bytes);
+}
+#endif
+
+#if defined(L2_AVX2)
+TARGET_AVX2 static inline int l2Avx2(const uchar *a, const uchar *b, int bytes)
+{
+    // 16 bytes per step widened to 16-bit, differences squared and pairwise summed to 32-bit with madd
+    int i = 0;
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 16 <= bytes; i += 16)
+    {
+        __m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(a + i)));
+        __m256i y = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(b + i)));
+        __m256i d = _mm256_sub_epi16(x, y);
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(d, d));
+    }
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum) + l2Tail(a, b, i, bytes);
+}
+#endif
+
+static void l2RowScalar(const uchar *query, const cv::Mat &descRef, int *dists)
+{
+    for (int r = 0; r < descRef.rows; r++)
+        dists[r] = l2Scalar(query, descRef.ptr<uchar>(r), descRef.cols);
+}
+
+#if defined(L2_AVX512)
+TARGET_L2_AVX512 static int l2DistanceAvx512(const uchar *a, const uchar *b, int bytes)
+{
+    return l2Avx512(a, b, bytes);
+}
+
+TARGET_L2_AVX512 static void l2RowAvx512(const uchar *query, const cv::Mat &descRef, int *dists)
+{
+    for (int r = 0; r < descRef.rows; r++)
+        dists[r] = l2Avx512(query, descRef.ptr<uchar>(r), descRef.cols);
+}
+#endif
+
+#if defined(L2_AVX2)
+TARGET_AVX2 static int l2DistanceAvx2(const uchar *a, const uchar *b, int bytes)
+{
+    return l2Avx2(a, b, bytes);
+}
+
+TARGET_AVX2 static void l2RowAvx2(const uchar *query, const cv::Mat &descRef, int *dists)
+{
+    for (int r = 0; r < descRef.rows; r++)
+        dists[r] = l2Avx2(query, descRef.ptr<uchar>(r), descRef.cols);
+}
+#endif
+
+static DistanceKernels selectL2Kernels()
+{
+#if defined(L2_AVX512)
+    if (cpuSupports("avx512-l2"))
+        return DistanceKernels{"AVX-512BW", l2DistanceAvx512, l2RowAvx512};
+#endif
+#if defined(L2_AVX2)
+    if (cpuSupports("avx2"))
+        return DistanceKernels{"AVX2", l2DistanceAvx2, l2RowAvx2};
+#endif
+    return DistanceKernels{"scalar", l2Scalar, l2RowScalar};
+}
+
+static const DistanceKernels &l2Kernels()
+{
+    static const DistanceKernels kernels = selectL2Kernels();
+    return kernels;
+}
+
+const char *l2Implementation()
+{
+    return l2Kernels().name;
+}
+
+int l2SquaredDistance(const uchar *a, const uchar *b, int bytes)
+{
+    return l2Kernels().distance(a, b, bytes);
+}
+
+void matchL2NN(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<cv::DMatch> &matches)
+{
+    if (descSource.empty() || descRef.empty()) // a frame without keypoints has a 0x0 descriptor matrix
+        return;
+    CV_Assert(descSource.depth() == CV_8U && descRef.depth() == CV_8U && descSource.cols == descRef.cols);
+
+    const DistanceKernels &kernels = l2Kernels();
+    int *dists = distanceBuffer(descRef.rows);
+    matches.reserve(matches.size() + descSource.rows);
+    for (int q = 0; q < descSource.rows; q++)
+    {
+        kernels.distanceRow(descSource.ptr<uchar>(q), descRef, dists);
+        int best = INT_MAX, bestIdx = -1;
+        for (int r = 0; r < descRef.rows; r++)
+        {
+            int dist = dists[r];
+            if (dist < best)
+            {
+                best = dist;
+                bestIdx = r;
+            }
+        }
+        matches.push_back(cv::DMatch(q, bestIdx, sqrt((float)best)));
+    }
+}
+
+void matchL2KnnRatio(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<cv::DMatch> &matches,
+                     double minDescDistRatio)
+{
+    if (descSource.empty() || descRef.rows < 2) // ratio test needs a second best match
+        return;
+    CV_Assert(descSource.depth() == CV_8U && descRef.depth() == CV_8U && descSource.cols == descRef.cols);
+
+    const DistanceKernels &kernels = l2Kernels();
+    int *dists = distanceBuffer(descRef.rows);
+    double ratioSq = minDescDistRatio * minDescDistRatio;
+    for (int q = 0; q < descSource.rows; q++)
+    {
+        kernels.distanceRow(descSource.ptr<uchar>(q), descRef, dists);
+
+        // keep the two best distances, ties keep the lower reference index first (same order as cv::BFMatcher)
+        int best = INT_MAX, second = INT_MAX, bestIdx = -1;
+        for (int r = 0; r < descRef.rows; r++)
+        {
+            int dist = dists[r];
+            if (dist < best)
+            {
+                second = best;
+                best = dist;
+                bestIdx = r;
+            }
+            else if (dist < second)
+                second = dist;
+        }
+
+        // descriptor distance ratio test on the squared distances
+        if (best < ratioSq * second)
+            matches.push_back(cv::DMatch(q, bestIdx, sqrt((float)best)));
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef simdMatching_hpp
+#define simdMatching_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+
+// Exact brute-force matching for packed binary descriptors (CV_8U, one descriptor per row)
+// Hamming distances use AVX-512 VPOPCNTDQ or AVX2 if the CPU supports them, otherwise 64-bit scalar popcount. GCC and
+// Clang on x86-64 select the kernel at runtime, other compilers only build the kernels they target (see
+// ENABLE_NATIVE_ARCH in CMakeLists.txt). Only the best two distances per query are kept and the ratio
+// test is applied inline, so matches are written straight into the output without intermediate knn lists.
+
+// Hamming distance between two descriptors of the given length in bytes
+int hammingDistance(const uchar *a, const uchar *b, int bytes);
+
+// nearest neighbor for every source descriptor, no matches if either side is empty (like cv::BFMatcher)
+void matchHammingNN(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<cv::DMatch> &matches);
+
+// best match for every source descriptor which passes the descriptor distance ratio test (best < ratio * second best)
+void matchHammingKnnRatio(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<cv::DMatch> &matches,
+                          double minDescDistRatio);
+
+// name of the popcount implementation selected for this CPU
+const char *hammingImplementation();
+
+
+// Exact brute-force matching for 8-bit quantized gradient descriptors (CV_8U, e.g. SIFT)
+// Squared L2 distances are summed in 32-bit integers with AVX-512BW or AVX2 multiply-add when available (selected
+// like the Hamming kernels). The ratio
+// test is applied to the squared distances (best^2 < ratio^2 * second^2), the matches carry the L2 distance like
+// cv::BFMatcher with NORM_L2.
+
+// quantize float descriptors to CV_8U: saturate(round(value * scale)). OpenCV's SIFT already scales its normalized
+// histograms to integers in [0, 255], so the default scale keeps SIFT descriptors lossless at a quarter of the size.
+void quantizeDescriptors(const cv::Mat &descriptors, cv::Mat &quantized, double scale = 1.0);
+
+// squared L2 distance between two descriptors of the given length in bytes
+int l2SquaredDistance(const uchar *a, const uchar *b, int bytes);
+
+// nearest neighbor for every source descriptor, no matches if either side is empty (like cv::BFMatcher)
+void matchL2NN(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<cv::DMatch> &matches);
+
+// best match for every source descriptor which passes the descriptor distance ratio test (best < ratio * second best)
+void matchL2KnnRatio(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<cv::DMatch> &matches,
+                     double minDescDistRatio);
+
+// name of the squared L2 implementation selected for this CPU
+const char *l2Implementation();
+
+#endif /* simdMatching_hpp */
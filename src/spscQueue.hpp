@@ -0,0 +1,67 @@
+#ifndef spscQueue_hpp
+#define spscQueue_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+// Bounded lock-free single-producer/single-consumer queue
+// One slot is kept free to distinguish a full from an empty ring. Head and tail are padded onto separate cache lines
+// so producer and consumer do not invalidate each other's line on every operation.
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity) : slots(capacity + 1), head(0), tail(0) {}
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // producer side, returns false if the queue is full
+    bool tryPush(T &item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t next = increment(t);
+        if (next == head.load(std::memory_order_acquire))
+            return false;
+
+        slots[t] = std::move(item);
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, returns false if the queue is empty
+    bool tryPop(T &item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+
+        item = std::move(slots[h]);
+        head.store(increment(h), std::memory_order_release);
+        return true;
+    }
+
+    // approximate number of queued items, exact when called from producer or consumer while the other side is idle
+    size_t size() const
+    {
+        size_t h = head.load(std::memory_order_acquire);
+        size_t t = tail.load(std::memory_order_acquire);
+        return t >= h ? t - h : t + slots.size() - h;
+    }
+
+    size_t capacity() const { return slots.size() - 1; }
+
+private:
+    size_t increment(size_t idx) const { return idx + 1 == slots.size() ? 0 : idx + 1; }
+
+    std::vector<T> slots;
+    char padHead[64];
+    std::atomic<size_t> head; // next slot to read, written by the consumer
+    char padTail[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail; // next slot to write, written by the producer
+};
+
+#endif /* spscQueue_hpp */
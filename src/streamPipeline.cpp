@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <memory>
+#include <thread>
+
+#include "streamPipeline.hpp"
+#include "tracing.hpp"
+#include "spscQueue.hpp"
+
+using namespace std;
+
+static double elapsedMs(double tStart)
+{
+    return (((double)cv::getTickCount() - tStart) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+}
+
+// spin briefly, then yield, then sleep so idle stages do not burn a core
+static void backoff(int &spins)
+{
+    if (++spins < 64)
+        return;
+    if (spins < 256)
+        this_thread::yield();
+    else
+        this_thread::sleep_for(chrono::microseconds(50));
+}
+
+StreamPipeline::StreamPipeline(const PipelineConfig &config, const cv::Rect &roi, size_t queueCapacity)
+    : detectPipeline(config), describePipeline(config), matchPipeline(config), roi(roi),
+      queueCapacity(max<size_t>(1, queueCapacity)), bHasPrevious(false)
+{
+}
+
+void StreamPipeline::detectStage(StreamItem &item)
+{
+    TRACE_SCOPE("stream detect");
+    detectPipeline.detect(item.frame.keypoints, item.frame.cameraImg);
+    item.keypointsTotal = item.frame.keypoints.size();
+}
+
+void StreamPipeline::roiStage(StreamItem &item)
+{
+    TRACE_SCOPE("stream ROI filter");
+    if (roi.area() == 0)
+        return;
+
+    // only keep keypoints on the preceding vehicle, compacted in place
+    vector<cv::KeyPoint> &keypoints = item.frame.keypoints;
+    roiStore.assign(keypoints, KeypointStore::FIELD_POSITION);
+    roiStore.selectInRect(roi, roiSelection);
+    for (size_t j = 0; j < roiSelection.size(); j++)
+        keypoints[j] = keypoints[roiSelection[j]];
+    keypoints.resize(roiSelection.size());
+}
+
+void StreamPipeline::describeStage(StreamItem &item)
+{
+    TRACE_SCOPE("stream describe");
+    describePipeline.describe(item.frame.keypoints, item.frame.cameraImg, item.frame.descriptors);
+}
+
+void StreamPipeline::matchStage(StreamItem &item)
+{
+    TRACE_SCOPE("stream match");
+    if (bHasPrevious) // only attempt matching if at least two images have been processed
+        matchPipeline.match(previousFrame, item.frame, item.frame.kptMatches);
+}
+
+void StreamPipeline::run(const FrameSourceFunction &source, const FrameSinkFunction &sink)
+{
+    typedef void (StreamPipeline::*StageFunction)(StreamItem &);
+    const vector<pair<string, StageFunction>> stages = {
+        {"detect", &StreamPipeline::detectStage},
+        {"roi", &StreamPipeline::roiStage},
+        {"describe", &StreamPipeline::describeStage},
+        {"match", &StreamPipeline::matchStage}};
+
+    stageStats.assign(stages.size() + 1, StageStatistic());
+    stageStats[0].name = "load";
+    for (size_t i = 0; i < stages.size(); i++)
+        stageStats[i + 1].name = stages[i].first;
+    bHasPrevious = false;
+
+    // queues[i] connects stage i with stage i+1
+    vector<unique_ptr<SpscQueue<StreamItem>>> queues;
+    for (size_t i = 0; i < stages.size(); i++)
+        queues.emplace_back(new SpscQueue<StreamItem>(queueCapacity));
+
+    // push with back-pressure, time spent blocked is accounted to the producing stage
+    auto push = [](SpscQueue<StreamItem> &queue, StreamItem &item, StageStatistic &stat) {
+        TRACE_SCOPE("queue push");
+        double t = (double)cv::getTickCount();
+        int spins = 0;
+        while (!queue.tryPush(item))
+            backoff(spins);
+        stat.outputWaitTime += elapsedMs(t);
+    };
+
+    // exceptions are caught per stage (index 0: load), the end of stream still travels through all queues, so every
+    // stage exits and the threads can be joined before the first error is rethrown
+    vector<exception_ptr> errors(stages.size() + 1);
+    atomic<bool> bAbort(false);
+
+    vector<thread> workers;
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        workers.emplace_back([&, i] {
+            StageStatistic &stat = stageStats[i + 1];
+            setTraceThreadName("stage " + stat.name);
+            SpscQueue<StreamItem> &input = *queues[i];
+            bool bLast = i + 1 == stages.size();
+
+            while (true)
+            {
+                StreamItem item;
+                double t = (double)cv::getTickCount();
+                int spins = 0;
+                while (!input.tryPop(item))
+                    backoff(spins);
+                stat.inputWaitTime += elapsedMs(t);
+
+                if (item.bEndOfStream)
+                {
+                    if (!bLast)
+                        push(*queues[i + 1], item, stat);
+                    return;
+                }
+                if (bAbort) // drain the queue until the end of stream arrives
+                    continue;
+
+                size_t depth = input.size() + 1; // including the item just taken
+                stat.queueDepthSum += depth;
+                stat.maxQueueDepth = max(stat.maxQueueDepth, depth);
+
+                try
+                {
+                    t = (double)cv::getTickCount();
+                    (this->*stages[i].second)(item);
+                    double latency = elapsedMs(t);
+                    stat.busyTime += latency;
+                    stat.maxLatency = max(stat.maxLatency, latency);
+                    stat.frames++;
+
+                    if (bLast)
+                    {
+                        sink(item);
+                        previousFrame = move(item.frame);
+                        bHasPrevious = true;
+                    }
+                    else
+                        push(*queues[i + 1], item, stat);
+                }
+                catch (...)
+                {
+                    errors[i + 1] = current_exception();
+                    bAbort = true;
+                }
+            }
+        });
+    }
+
+    // load stage runs on the calling thread
+    StageStatistic &loadStat = stageStats[0];
+    for (size_t frameIndex = 0;; frameIndex++)
+    {
+        StreamItem item;
+        item.frameIndex = frameIndex;
+
+        double t = (double)cv::getTickCount();
+        bool bValid = false;
+        try
+        {
+            TRACE_SCOPE("stream load");
+            bValid = !bAbort && source(frameIndex, item.frame.cameraImg); // stop feeding frames after an error
+        }
+        catch (...)
+        {
+            errors[0] = current_exception();
+            bAbort = true;
+        }
+        double latency = elapsedMs(t);
+
+        if (!bValid)
+        {
+            item.bEndOfStream = true;
+            push(*queues[0], item, loadStat);
+            break;
+        }
+
+        loadStat.busyTime += latency;
+        loadStat.maxLatency = max(loadStat.maxLatency, latency);
+        loadStat.frames++;
+        push(*queues[0], item, loadStat);
+    }
+
+    for (auto it = workers.begin(); it != workers.end(); ++it)
+        (*it).join();
+
+    for (auto it = errors.begin(); it != errors.end(); ++it)
+        if (*it)
+            rethrow_exception(*it);
+}
+
+void StreamPipeline::printStatistics(std::ostream &os) const
+{
+    os << setw(10) << "stage" << setw(8) << "frames" << setw(14) << "mean [ms]" << setw(12) << "max [ms]"
+       << setw(14) << "starved [ms]" << setw(14) << "blocked [ms]" << setw(12) << "mean queue" << setw(11) << "max queue" << endl;
+
+    for (auto it = stageStats.begin(); it != stageStats.end(); ++it)
+    {
+        double frames = max<size_t>(1, (*it).frames);
+        os << setw(10) << (*it).name << setw(8) << (*it).frames
+           << setw(14) << (*it).busyTime / frames << setw(12) << (*it).maxLatency
+           << setw(14) << (*it).inputWaitTime << setw(14) << (*it).outputWaitTime
+           << setw(12) << (*it).queueDepthSum / frames << setw(11) << (*it).maxQueueDepth << endl;
+    }
+}
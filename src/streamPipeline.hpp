@@ -0,0 +1,75 @@
+#ifndef streamPipeline_hpp
+#define streamPipeline_hpp
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "featurePipeline.hpp"
+#include "keypointStore.hpp"
+
+
+struct StreamItem { // one frame travelling through the stages
+
+    size_t frameIndex = 0;
+    bool bEndOfStream = false;
+
+    DataFrame frame;
+    size_t keypointsTotal = 0; // keypoints before ROI filtering
+};
+
+struct StageStatistic { // per-stage counters, written only by the stage's own thread
+
+    std::string name;
+    size_t frames = 0;
+
+    double busyTime = 0.0;       // [ms] total processing time
+    double maxLatency = 0.0;     // [ms] slowest frame
+    double inputWaitTime = 0.0;  // [ms] starved, waiting for the previous stage
+    double outputWaitTime = 0.0; // [ms] blocked, waiting for the next stage to make room
+
+    size_t queueDepthSum = 0;    // depth of the input queue, sampled on every frame
+    size_t maxQueueDepth = 0;
+};
+
+// Streaming mode: load -> detect -> ROI filter -> describe -> match, one thread per stage
+// Stages are joined by bounded lock-free SPSC queues, so frame N+1 is loaded and detected while frame N is still
+// being described and matched against frame N-1. Every stage owns its own FeaturePipeline instance.
+class StreamPipeline
+{
+public:
+    typedef std::function<bool(size_t frameIndex, cv::Mat &img)> FrameSourceFunction; // returns false at end of stream
+    typedef std::function<void(const StreamItem &item)> FrameSinkFunction;            // called by the match stage
+
+    StreamPipeline(const PipelineConfig &config, const cv::Rect &roi, size_t queueCapacity = 4);
+
+    // blocks until the source is exhausted and all frames have passed the last stage. If the source, a stage or the
+    // sink throws, the remaining frames are dropped, all stages are stopped and the exception of the first failing stage is rethrown.
+    void run(const FrameSourceFunction &source, const FrameSinkFunction &sink);
+
+    const std::vector<StageStatistic> &statistics() const { return stageStats; }
+    void printStatistics(std::ostream &os) const;
+
+private:
+    void detectStage(StreamItem &item);
+    void roiStage(StreamItem &item);
+    void describeStage(StreamItem &item);
+    void matchStage(StreamItem &item);
+
+    FeaturePipeline detectPipeline, describePipeline, matchPipeline;
+    cv::Rect roi; // empty rectangle disables ROI filtering
+    KeypointStore roiStore;   // scratch of the ROI stage
+    std::vector<int> roiSelection;
+    size_t queueCapacity;
+
+    DataFrame previousFrame; // owned by the match stage
+    bool bHasPrevious;
+
+    std::vector<StageStatistic> stageStats;
+};
+
+#endif /* streamPipeline_hpp */
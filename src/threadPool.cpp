@@ -0,0 +1,137 @@
+#include <algorithm>
+#include "threadPool.hpp"
+#include "tracing.hpp"
+
+using namespace std;
+
+static thread_local const ThreadPool *tlsPool = nullptr;
+static thread_local int tlsWorker = -1;
+
+ThreadPool::ThreadPool(unsigned int numThreads, std::function<void(unsigned int)> onStart)
+    : onStart(move(onStart)), pendingTasks(0), queuedTasks(0), nextQueue(0), bStop(false)
+{
+    numThreads = max(1u, numThreads);
+    for (unsigned int i = 0; i < numThreads; i++)
+        queues.emplace_back(new WorkQueue());
+
+    for (unsigned int i = 0; i < numThreads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(stateMutex);
+        bStop = true;
+    }
+    taskAvailable.notify_all();
+    for (auto it = workers.begin(); it != workers.end(); ++it)
+        (*it).join();
+}
+
+int ThreadPool::currentWorker()
+{
+    return tlsWorker;
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    unsigned int target;
+    if (tlsPool == this)
+        target = (unsigned int)tlsWorker; // keep nested work local, others will steal if idle
+    else
+        target = nextQueue++ % queues.size();
+
+    {
+        lock_guard<mutex> lock(stateMutex);
+        ++pendingTasks;
+        ++queuedTasks;
+    }
+    {
+        lock_guard<mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    unique_lock<mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return pendingTasks == 0; });
+
+    if (firstError)
+    {
+        exception_ptr error = firstError;
+        firstError = nullptr;
+        rethrow_exception(error);
+    }
+}
+
+bool ThreadPool::popTask(unsigned int worker, std::function<void()> &task)
+{
+    // own queue first (LIFO, cache friendly)
+    {
+        WorkQueue &own = *queues[worker];
+        lock_guard<mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            --queuedTasks;
+            return true;
+        }
+    }
+
+    // steal the oldest task from another worker (FIFO)
+    for (size_t i = 1; i < queues.size(); i++)
+    {
+        WorkQueue &victim = *queues[(worker + i) % queues.size()];
+        lock_guard<mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --queuedTasks;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned int worker)
+{
+    tlsPool = this;
+    tlsWorker = (int)worker;
+    setTraceThreadName("worker " + to_string(worker));
+    if (onStart)
+        onStart(worker);
+
+    while (true)
+    {
+        function<void()> task;
+        if (popTask(worker, task))
+        {
+            exception_ptr error;
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                error = current_exception();
+            }
+
+            lock_guard<mutex> lock(stateMutex);
+            if (error && !firstError)
+                firstError = error;
+            if (--pendingTasks == 0)
+                allDone.notify_all();
+            continue;
+        }
+
+        unique_lock<mutex> lock(stateMutex);
+        taskAvailable.wait(lock, [this] { return bStop || queuedTasks > 0; });
+        if (bStop && queuedTasks == 0)
+            return;
+    }
+}
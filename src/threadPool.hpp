@@ -0,0 +1,64 @@
+#ifndef threadPool_hpp
+#define threadPool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Work-stealing thread pool
+// Every worker owns a task deque. Workers take tasks from the back of their own deque and steal from the front of
+// the other deques when they run dry, so long running tasks (e.g. SIFT combinations) do not leave cores idle.
+class ThreadPool
+{
+public:
+    // onStart runs first on every worker thread with its index, e.g. to pin it to a core. Threads inherit the CPU
+    // affinity of the thread creating the pool otherwise.
+    explicit ThreadPool(unsigned int numThreads = std::thread::hardware_concurrency(),
+                        std::function<void(unsigned int)> onStart = nullptr);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // tasks submitted from a worker go to its own deque, all others are distributed round robin
+    void submit(std::function<void()> task);
+
+    // block until all submitted tasks are finished, rethrows the first exception thrown by a task
+    void wait();
+
+    unsigned int size() const { return (unsigned int)workers.size(); }
+
+    // index of the calling worker thread in its pool, -1 if not called from a pool thread
+    static int currentWorker();
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool popTask(unsigned int worker, std::function<void()> &task);
+    void workerLoop(unsigned int worker);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::function<void(unsigned int)> onStart;
+
+    std::mutex stateMutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allDone;
+    size_t pendingTasks;             // submitted but not yet finished
+    std::atomic<long> queuedTasks;   // submitted but not yet started
+    std::atomic<unsigned int> nextQueue;
+    std::exception_ptr firstError;
+    bool bStop;
+};
+
+#endif /* threadPool_hpp */
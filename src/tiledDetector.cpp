@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+#include "tiledDetector.hpp"
+#include "keypointNMS.hpp"
+#include "tracing.hpp"
+
+using namespace std;
+
+TiledDetector::TiledDetector(const PipelineConfig &config, int tileRows, int tileCols, int keypointBudget, unsigned int numThreads,
+                             std::function<void(unsigned int)> onWorkerStart)
+    : cfg(config), tileRows(max(1, tileRows)), tileCols(max(1, tileCols)), keypointBudget(max(0, keypointBudget))
+{
+    int numTiles = this->tileRows * this->tileCols;
+    unsigned int workers = max(1u, min(numThreads, (unsigned int)numTiles));
+    if (workers > 1)
+        pool.reset(new ThreadPool(workers, move(onWorkerStart)));
+    for (int i = 0; i < numTiles; i++)
+        pipelines.emplace_back(new FeaturePipeline(cfg));
+    tileKeypoints.resize(numTiles);
+    tileMeasured.resize(numTiles);
+    tileMin.resize(numTiles);
+    tileMax.resize(numTiles);
+}
+
+double TiledDetector::detect(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const cv::Rect &area)
+{
+    TRACE_SCOPE("detect tiled");
+    double t = (double)cv::getTickCount();
+
+    // split the area into tiles, the last row/column takes the remainder
+    cv::Rect region = area & cv::Rect(cv::Point(0, 0), img.size());
+    tiles.clear();
+    for (int r = 0; r < tileRows; r++)
+    {
+        for (int c = 0; c < tileCols; c++)
+        {
+            int x0 = region.x + region.width * c / tileCols, x1 = region.x + region.width * (c + 1) / tileCols;
+            int y0 = region.y + region.height * r / tileRows, y1 = region.y + region.height * (r + 1) / tileRows;
+            tiles.push_back(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+        }
+    }
+
+    // relative thresholds: all tiles use the response range of the whole area, as a single detection over it would
+    if (pipelines[0]->usesRelativeThreshold())
+    {
+        forEachTile([this, &img](size_t i) {
+            TRACE_SCOPE("measure tile");
+            tileMeasured[i] = tiles[i].area() > 0 && pipelines[i]->measureResponseRange(img, tiles[i], tileMin[i], tileMax[i]);
+        });
+
+        double minResponse = DBL_MAX, maxResponse = -DBL_MAX;
+        for (size_t i = 0; i < tiles.size(); i++)
+        {
+            if (!tileMeasured[i])
+                continue;
+            minResponse = min(minResponse, tileMin[i]);
+            maxResponse = max(maxResponse, tileMax[i]);
+        }
+        for (size_t i = 0; i < tiles.size(); i++)
+        {
+            if (minResponse <= maxResponse)
+                pipelines[i]->setResponseRange(minResponse, maxResponse);
+            else
+                pipelines[i]->clearResponseRange();
+        }
+    }
+
+    forEachTile([this, &img](size_t i) {
+        TRACE_SCOPE("detect tile");
+        tileKeypoints[i].clear();
+        if (tiles[i].area() > 0)
+            pipelines[i]->detect(tileKeypoints[i], img, vector<cv::Rect>(1, tiles[i]));
+    });
+
+    if (keypointBudget > 0)
+        applyBudget();
+
+    size_t first = keypoints.size();
+    for (auto it = tileKeypoints.begin(); it != tileKeypoints.end(); ++it)
+        keypoints.insert(keypoints.end(), (*it).begin(), (*it).end());
+
+    // only the keypoints of this call take part in the seam merge
+    vector<cv::KeyPoint> detected(keypoints.begin() + first, keypoints.end());
+    mergeSeams(detected, img.size());
+    keypoints.erase(keypoints.begin() + first, keypoints.end());
+    keypoints.insert(keypoints.end(), detected.begin(), detected.end());
+
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
+
+// runs task for every tile on the pool, or one after the other on the calling thread
+void TiledDetector::forEachTile(const std::function<void(size_t)> &task)
+{
+    if (!pool)
+    {
+        for (size_t i = 0; i < tiles.size(); i++)
+            task(i);
+        return;
+    }
+    for (size_t i = 0; i < tiles.size(); i++)
+        pool->submit([i, &task] { task(i); });
+    pool->wait();
+}
+
+void TiledDetector::applyBudget()
+{
+    // tiles with fewer keypoints than their share pass the rest on, smallest tiles first
+    vector<int> order(tileKeypoints.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [this](int a, int b) { return tileKeypoints[a].size() < tileKeypoints[b].size(); });
+
+    int remaining = keypointBudget;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        vector<cv::KeyPoint> &kpts = tileKeypoints[order[i]];
+        int share = remaining / (int)(order.size() - i);
+        if ((int)kpts.size() > share)
+        {
+            if (cfg.detectorType == DetectorType::SHITOMASI)
+                kpts.resize(share); // there is no response info, corners are sorted in descending quality order
+            else
+            {
+                cv::KeyPointsFilter::retainBest(kpts, share);
+                kpts.resize(min(kpts.size(), (size_t)share)); // retainBest keeps all keypoints tied with the last one
+            }
+        }
+        remaining -= (int)kpts.size();
+    }
+}
+
+double TiledDetector::seamMaxOverlap() const
+{
+    switch (cfg.detectorType)
+    {
+    case DetectorType::SHITOMASI:
+    case DetectorType::HARRIS:
+    case DetectorType::HARRIS_FUSED:
+        return 0.0; // same suppression as inside a tile
+    default:
+        return 0.8; // multi-scale detectors do no overlap NMS, only drop near identical keypoints
+    }
+}
+
+void TiledDetector::mergeSeams(std::vector<cv::KeyPoint> &keypoints, const cv::Size &imgSize) const
+{
+    TRACE_SCOPE("merge seams");
+    if (tiles.size() < 2 || keypoints.empty())
+        return;
+
+    // two overlapping keypoints on different sides of a seam are both closer to it than the largest keypoint size
+    float seamWidth = 0.0f;
+    for (auto it = keypoints.begin(); it != keypoints.end(); ++it)
+        seamWidth = max(seamWidth, (*it).size);
+
+    const cv::Rect &first = tiles.front(), &last = tiles.back();
+    auto nearSeam = [&](const cv::KeyPoint &kpt) {
+        for (auto tile = tiles.begin(); tile != tiles.end(); ++tile)
+        {
+            if (!(*tile).contains(kpt.pt))
+                continue;
+            // only edges shared with another tile are seams
+            return ((*tile).x > first.x && kpt.pt.x - (*tile).x < seamWidth) ||
+                   ((*tile).br().x < last.br().x && (*tile).br().x - kpt.pt.x < seamWidth) ||
+                   ((*tile).y > first.y && kpt.pt.y - (*tile).y < seamWidth) ||
+                   ((*tile).br().y < last.br().y && (*tile).br().y - kpt.pt.y < seamWidth);
+        }
+        return false;
+    };
+
+    // interior keypoints are kept as they are, seam keypoints go through the NMS in tile order
+    vector<cv::KeyPoint> seamCandidates, merged;
+    auto interiorEnd = stable_partition(keypoints.begin(), keypoints.end(), [&](const cv::KeyPoint &kpt) { return !nearSeam(kpt); });
+    seamCandidates.assign(interiorEnd, keypoints.end());
+    keypoints.erase(interiorEnd, keypoints.end());
+
+    KeypointGridNMS nms(merged, imgSize, max(seamWidth, 1.0f), seamMaxOverlap());
+    for (auto it = seamCandidates.begin(); it != seamCandidates.end(); ++it)
+        nms.insert(*it);
+    keypoints.insert(keypoints.end(), merged.begin(), merged.end());
+}
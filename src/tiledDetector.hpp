@@ -0,0 +1,54 @@
+#ifndef tiledDetector_hpp
+#define tiledDetector_hpp
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "featurePipeline.hpp"
+#include "threadPool.hpp"
+
+
+// Tiled multi-threaded keypoint detection
+// The detection area is split into tileRows x tileCols tiles which are detected concurrently, each tile through
+// FeaturePipeline's ROI detection (tile plus the detector's border, keypoints owned by the tile they fall into).
+// Keypoints close to a seam are merged with a cross-tile NMS, so a corner seen by two tiles is only reported once.
+// With a keypoint budget the strongest keypoints of every tile are kept, the budget is spread evenly over the tiles
+// and the share of tiles with fewer keypoints goes to the others.
+// SHITOMASI and HARRIS thresholds are relative to the response range, so the tiles first measure their range and
+// then all detect with the range of the whole area. The response of the first pass is kept for the second one.
+class TiledDetector
+{
+public:
+    // numThreads 1 detects the tiles one after the other on the calling thread, e.g. if the caller is one of
+    // several concurrent workers already. onWorkerStart is passed on to the ThreadPool (e.g. CPU pinning).
+    TiledDetector(const PipelineConfig &config, int tileRows, int tileCols, int keypointBudget = 0,
+                  unsigned int numThreads = std::thread::hardware_concurrency(),
+                  std::function<void(unsigned int)> onWorkerStart = nullptr);
+
+    // detect inside area (e.g. the whole image or an object box), returns the processing time in ms
+    double detect(std::vector<cv::KeyPoint> &keypoints, const cv::Mat &img, const cv::Rect &area);
+
+private:
+    void forEachTile(const std::function<void(size_t)> &task);
+    void applyBudget();
+    void mergeSeams(std::vector<cv::KeyPoint> &keypoints, const cv::Size &imgSize) const;
+    double seamMaxOverlap() const;
+
+    PipelineConfig cfg;
+    int tileRows, tileCols;
+    int keypointBudget; // 0: unlimited
+
+    std::unique_ptr<ThreadPool> pool; // empty with a single thread, the tiles then run on the calling thread
+
+    // per tile, reused between frames
+    std::vector<std::unique_ptr<FeaturePipeline>> pipelines; // a pipeline keeps the tile's response between the passes
+    std::vector<cv::Rect> tiles;
+    std::vector<char> tileMeasured;
+    std::vector<double> tileMin, tileMax; // response range of the tile's detection window
+    std::vector<std::vector<cv::KeyPoint>> tileKeypoints;
+};
+
+#endif /* tiledDetector_hpp */
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tracing.hpp"
+
+using namespace std;
+
+#if defined(ENABLE_TRACING)
+
+struct TraceEvent {
+    const char *name;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+struct TraceBuffer { // events of one thread, only written by that thread
+    int threadId;
+    string threadName;
+    vector<TraceEvent> events;
+};
+
+// buffers are owned by the registry, so events of finished threads (e.g. pool workers) survive until export.
+// When a thread exits, its events are copied into a right-sized vector and the grown vector is kept for the next new
+// thread, so pools created per combination or frame do not allocate a fresh buffer for every worker.
+static const size_t maxSpareBuffers = 16;
+static mutex registryMutex;
+static vector<unique_ptr<TraceBuffer>> registry;
+static vector<vector<TraceEvent>> spareEvents; // empty, with capacity
+
+struct ThreadBufferLease { // returns the capacity of the buffer when its thread exits
+    TraceBuffer *buffer = nullptr;
+
+    ~ThreadBufferLease()
+    {
+        if (!buffer)
+            return;
+        vector<TraceEvent> finished(buffer->events.begin(), buffer->events.end());
+        lock_guard<mutex> lock(registryMutex);
+        swap(finished, buffer->events);
+        if (spareEvents.size() < maxSpareBuffers)
+        {
+            finished.clear();
+            spareEvents.push_back(move(finished));
+        }
+    }
+};
+
+static TraceBuffer &threadBuffer()
+{
+    static thread_local ThreadBufferLease lease;
+    if (!lease.buffer)
+    {
+        lock_guard<mutex> lock(registryMutex);
+        registry.push_back(unique_ptr<TraceBuffer>(new TraceBuffer()));
+        lease.buffer = registry.back().get();
+        lease.buffer->threadId = (int)registry.size();
+        if (!spareEvents.empty())
+        {
+            lease.buffer->events = move(spareEvents.back());
+            spareEvents.pop_back();
+        }
+        else
+            lease.buffer->events.reserve(1 << 10); // grows with the events of busy threads
+    }
+    return *lease.buffer;
+}
+
+void recordTraceEvent(const char *name, uint64_t startNs, uint64_t endNs)
+{
+    TraceEvent event = {name, startNs, endNs};
+    threadBuffer().events.push_back(event);
+}
+
+void setTraceThreadName(const std::string &name)
+{
+    threadBuffer().threadName = name;
+}
+
+static string jsonEscape(const char *str)
+{
+    string escaped;
+    for (; *str; ++str)
+    {
+        if (*str == '"' || *str == '\\')
+            escaped += '\\';
+        escaped += *str;
+    }
+    return escaped;
+}
+
+bool writeChromeTrace(const std::string &filename)
+{
+    ofstream file(filename, ios::out | ios::trunc);
+    if (!file)
+        return false;
+
+    lock_guard<mutex> lock(registryMutex);
+
+    // timestamps relative to the first event, in microseconds
+    uint64_t originNs = UINT64_MAX;
+    for (auto buffer = registry.begin(); buffer != registry.end(); ++buffer)
+        for (auto it = (*buffer)->events.begin(); it != (*buffer)->events.end(); ++it)
+            originNs = min(originNs, (*it).startNs);
+
+    file << fixed << setprecision(3);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool bFirst = true;
+    for (auto buffer = registry.begin(); buffer != registry.end(); ++buffer)
+    {
+        if (!(*buffer)->threadName.empty())
+        {
+            file << (bFirst ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << (*buffer)->threadId
+                 << ", \"args\": {\"name\": \"" << jsonEscape((*buffer)->threadName.c_str()) << "\"}}";
+            bFirst = false;
+        }
+
+        for (auto it = (*buffer)->events.begin(); it != (*buffer)->events.end(); ++it)
+        {
+            file << (bFirst ? "\n" : ",\n") << "{\"name\": \"" << jsonEscape((*it).name) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                 << (*buffer)->threadId << ", \"ts\": " << ((*it).startNs - originNs) / 1000.0
+                 << ", \"dur\": " << ((*it).endNs - (*it).startNs) / 1000.0 << "}";
+            bFirst = false;
+        }
+    }
+    file << "\n]}\n";
+    return (bool)file;
+}
+
+#else
+
+void setTraceThreadName(const std::string &name)
+{
+}
+
+bool writeChromeTrace(const std::string &filename)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef tracing_hpp
+#define tracing_hpp
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+
+// Scoped tracing, enabled at compile time with -DENABLE_TRACING (CMake option ENABLE_TRACING)
+// TRACE_SCOPE("name") records the lifetime of the enclosing scope as one complete event. Every thread appends to its
+// own buffer, so recording takes no lock; the mutex is only taken when a thread takes its buffer and when it exits.
+// Every thread gets its own row in the trace; the buffer capacity of finished threads is reused by new threads.
+// Names must be string literals (only the pointer is stored). Without ENABLE_TRACING the macro expands to nothing.
+
+#if defined(ENABLE_TRACING)
+
+inline uint64_t traceClockNs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void recordTraceEvent(const char *name, uint64_t startNs, uint64_t endNs);
+
+class ScopeTrace
+{
+public:
+    explicit ScopeTrace(const char *name) : name(name), startNs(traceClockNs()) {}
+    ~ScopeTrace() { recordTraceEvent(name, startNs, traceClockNs()); }
+
+    ScopeTrace(const ScopeTrace &) = delete;
+    ScopeTrace &operator=(const ScopeTrace &) = delete;
+
+private:
+    const char *name;
+    uint64_t startNs;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) ScopeTrace TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#else
+
+#define TRACE_SCOPE(name)
+
+#endif
+
+// name shown for the calling thread in the trace viewer
+void setTraceThreadName(const std::string &name);
+
+// Chrome / Perfetto trace event JSON of all recorded events, call when the traced threads are idle or joined.
+// Returns false if tracing is compiled out or the file cannot be written.
+bool writeChromeTrace(const std::string &filename);
+
+#endif /* tracing_hpp */
@@ -0,0 +1,138 @@
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "windowMatching.hpp"
+#include "simdMatching.hpp"
+#include "tracing.hpp"
+
+using namespace std;
+
+KeyframeWindowMatcher::KeyframeWindowMatcher(size_t windowSize, int normType, double minDescDistRatio)
+    : windowSize(windowSize > 0 ? windowSize : 1), normType(normType), minDescDistRatio(minDescDistRatio),
+      frames(this->windowSize)
+{
+    clear();
+}
+
+void KeyframeWindowMatcher::clear()
+{
+    descType = -1;
+    descCols = 0;
+    rowBytes = 0;
+    for (auto it = frames.begin(); it != frames.end(); ++it)
+    {
+        (*it).rows = 0;
+        (*it).descriptors.clear(); // keeps the capacity for the next sequence
+    }
+    oldest = 0;
+    count = 0;
+    totalRows = 0;
+}
+
+void KeyframeWindowMatcher::push(int frameId, const cv::Mat &descriptors)
+{
+    TRACE_SCOPE("window push");
+    CV_Assert(descriptors.empty() || descriptors.type() == CV_8U || descriptors.type() == CV_32F);
+    if (!descriptors.empty())
+    {
+        if (descType < 0)
+        {
+            descType = descriptors.type();
+            descCols = descriptors.cols;
+            rowBytes = descriptors.cols * descriptors.elemSize();
+        }
+        CV_Assert(descriptors.type() == descType && descriptors.cols == descCols);
+    }
+
+    // the new frame takes the block of the oldest frame if the window is full
+    WindowFrame *entering;
+    if (count == windowSize)
+    {
+        entering = &frames[oldest];
+        totalRows -= entering->rows;
+        oldest = (oldest + 1) % windowSize;
+    }
+    else
+        entering = &frames[slot(count++)];
+
+    entering->frameId = frameId;
+    entering->rows = descriptors.rows;
+    entering->descriptors.resize(descriptors.rows * rowBytes);
+    for (int r = 0; r < descriptors.rows; r++)
+        memcpy(&entering->descriptors[r * rowBytes], descriptors.ptr(r), rowBytes);
+    totalRows += descriptors.rows;
+}
+
+double KeyframeWindowMatcher::match(const cv::Mat &descCurrent, std::vector<std::vector<cv::DMatch>> &matches)
+{
+    TRACE_SCOPE("match window");
+    double t = (double)cv::getTickCount();
+
+    matches.resize(count);
+    for (auto it = matches.begin(); it != matches.end(); ++it)
+        (*it).clear();
+    if (descCurrent.empty() || totalRows == 0)
+        return 0.0;
+    CV_Assert(descCurrent.type() == descType && descCurrent.cols == descCols);
+
+    int cols = descCols;
+    if (descType == CV_8U && normType == cv::NORM_HAMMING)
+        matchRows(descCurrent, [cols](const uchar *a, const uchar *b) { return (float)hammingDistance(a, b, cols); }, false, matches);
+    else if (descType == CV_8U)
+        matchRows(descCurrent, [cols](const uchar *a, const uchar *b) { return (float)l2SquaredDistance(a, b, cols); }, true, matches);
+    else
+        matchRows(descCurrent, [cols](const uchar *a, const uchar *b) {
+            const float *x = reinterpret_cast<const float *>(a), *y = reinterpret_cast<const float *>(b);
+            float sum = 0.0f;
+            for (int i = 0; i < cols; i++)
+            {
+                float d = x[i] - y[i];
+                sum += d * d;
+            }
+            return sum;
+        }, true, matches);
+
+    t = (((double)cv::getTickCount() - t) * 1000) / (cv::getTickFrequency() * 1.0); // [ms]
+    return t;
+}
+
+// one pass over the rows of all window frames, best and second best distance of every row in the current frame
+template <typename Distance>
+void KeyframeWindowMatcher::matchRows(const cv::Mat &descCurrent, Distance distance, bool bSquared, std::vector<std::vector<cv::DMatch>> &matches)
+{
+    bool bRatioTest = minDescDistRatio > 0;
+    double ratio = bSquared ? minDescDistRatio * minDescDistRatio : minDescDistRatio; // ratio test on squared L2
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const WindowFrame &frame = frames[slot(i)];
+        const uchar *query = frame.descriptors.data();
+        for (size_t q = 0; q < frame.rows; q++, query += rowBytes)
+        {
+            // ties keep the lower row first (same order as cv::BFMatcher)
+            float best = FLT_MAX, second = FLT_MAX;
+            int bestIdx = -1;
+            for (int r = 0; r < descCurrent.rows; r++)
+            {
+                float dist = distance(query, descCurrent.ptr(r));
+                if (dist < best)
+                {
+                    second = best;
+                    best = dist;
+                    bestIdx = r;
+                }
+                else if (dist < second)
+                    second = dist;
+            }
+
+            // descriptor distance ratio test, like knnMatch with k = 2 a current frame with a single row does not pass
+            if (bestIdx < 0)
+                continue;
+            if (bRatioTest && !(second < FLT_MAX && best < ratio * second))
+                continue;
+            float dist = bSquared ? sqrt(best) : best;
+            matches[i].push_back(cv::DMatch((int)q, bestIdx, frame.frameId, dist));
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef windowMatching_hpp
+#define windowMatching_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+
+// Batched brute-force matching of the current frame against a window of the last K frames
+// The descriptors of the window frames live in a ring of K row blocks, one per frame. A frame entering the window
+// copies its rows into the block of the oldest frame, which leaves it, so no rows are moved and the blocks keep their
+// capacity. match() runs the rows of all window frames as queries against the current frame in one pass, the query
+// side of the frame-to-frame matcher, so the result equals K separate brute-force matches of each window frame against
+// the current one.
+// Binary descriptors (CV_8U, NORM_HAMMING) use the SIMD Hamming distance, quantized (CV_8U, NORM_L2) and float
+// descriptors (CV_32F) the L2 distance.
+class KeyframeWindowMatcher
+{
+public:
+    // windowSize: max. number of frames matched against, minDescDistRatio <= 0 keeps the nearest neighbor per frame
+    KeyframeWindowMatcher(size_t windowSize, int normType, double minDescDistRatio);
+
+    // adds the frame as the newest window frame, the oldest frame leaves the window if it is full
+    void push(int frameId, const cv::Mat &descriptors);
+    void clear();
+
+    size_t size() const { return count; }
+    size_t rows() const { return totalRows; }
+    int frameId(size_t i) const { return frames[slot(i)].frameId; } // 0: oldest window frame
+
+    // matches[i] holds the matches of window frame i against the current frame: queryIdx is the row within frame i,
+    // trainIdx the row of descCurrent and imgIdx the frame id. Returns the processing time in ms.
+    double match(const cv::Mat &descCurrent, std::vector<std::vector<cv::DMatch>> &matches);
+
+private:
+    // one frame of the window, its descriptor rows are stored back to back
+    struct WindowFrame {
+        int frameId;
+        size_t rows;
+        std::vector<uchar> descriptors;
+    };
+
+    size_t slot(size_t i) const { return (oldest + i) % windowSize; } // ring position of window frame i
+
+    template <typename Distance>
+    void matchRows(const cv::Mat &descCurrent, Distance distance, bool bSquared, std::vector<std::vector<cv::DMatch>> &matches);
+
+    size_t windowSize;
+    int normType;
+    double minDescDistRatio;
+
+    int descType;    // CV_8U or CV_32F, -1 while the window is empty
+    int descCols;
+    size_t rowBytes;
+
+    std::vector<WindowFrame> frames; // ring of windowSize frames
+    size_t oldest;                   // ring position of the oldest window frame
+    size_t count;                    // frames in the window
+    size_t totalRows;                // descriptor rows of all window frames
+};
+
+#endif /* windowMatching_hpp */